@@ -20,9 +20,13 @@
   Boston, MA 02110-1301, USA.
  */
 
+#include <tqapplication.h>
 #include <tqbitmap.h>
+#include <tqdatetime.h>
+#include <tqdesktopwidget.h>
 #include <tqimage.h>
 #include <tqpainter.h>
+#include <tqtimer.h>
 
 #include <kpixmap.h>
 #include <kpixmapeffect.h>
@@ -32,32 +36,124 @@
 #include "q4win10.moc"
 #include "q4win10button.h"
 #include "q4win10client.h"
+#include "q4win10iconcache.h"
+#include "q4win10menubar.h"
+#include "q4win10profile.h"
+#include "q4win10record.h"
+#include "q4win10trace.h"
 
 namespace KWinQ4Win10 {
 
-Q4Win10Handler::Q4Win10Handler() {
-  memset(m_pixmaps, 0,
-         sizeof(TQPixmap *) * NumPixmaps * 2 * 2); // set elements to 0
-  memset(m_bitmaps, 0, sizeof(TQBitmap *) * NumButtonIcons * 2);
+static TQFont scaledFont(const TQFont &font, int scale) {
+  TQFont f(font);
+  if (f.pointSize() > 0)
+    f.setPointSize(f.pointSize() * scale);
+  else
+    f.setPixelSize(f.pixelSize() * scale);
+  return f;
+}
 
-  reset(0);
+TitleMetrics::TitleMetrics(const TQFont &font)
+    : m_metrics(font), m_height(m_metrics.height()) {
+  for (int i = 0; i < 256; ++i)
+    m_advances[i] = -1;
 }
 
-Q4Win10Handler::~Q4Win10Handler() {
+int TitleMetrics::advance(const TQChar &c) {
+  const ushort u = c.unicode();
+  if (u >= 256)
+    return -1;
+  if (m_advances[u] < 0)
+    m_advances[u] = m_metrics.width(c);
+  return m_advances[u];
+}
+
+Q4Win10Handler::TileSet::TileSet() {
+  memset(pixmaps, 0, sizeof(pixmaps)); // set elements to 0
+  memset(bitmaps, 0, sizeof(bitmaps));
+}
+
+Q4Win10Handler::TileSet::~TileSet() {
   for (int t = 0; t < 2; ++t)
     for (int a = 0; a < 2; ++a)
       for (int i = 0; i < NumPixmaps; ++i)
-        delete m_pixmaps[t][a][i];
+        delete pixmaps[t][a][i];
   for (int t = 0; t < 2; ++t)
     for (int i = 0; i < NumButtonIcons; ++i)
-      delete m_bitmaps[t][i];
+      delete bitmaps[t][i];
+}
+
+Q4Win10Handler::Q4Win10Handler()
+    : m_frameCacheUsed(0), m_frameSwaps(0), m_frameCacheDenied(0),
+      m_hoverColorsValid(false), m_captionsCoalesced(0), m_captionsDropped(0) {
+  m_tileSets.setAutoDelete(true);
+  memset(m_titleMetrics, 0, sizeof(m_titleMetrics));
+
+  m_animationTimer = new TQTimer(this);
+  connect(m_animationTimer, TQT_SIGNAL(timeout()), this,
+          TQT_SLOT(animationStep()));
+
+  // Q4WIN10_RECORD=<file> logs the decoration events
+  Recorder::init();
+
+  // Q4WIN10_TRACE=<file> records a timeline, written out once a second
+  Tracer::init();
+  if (Tracer::enabled()) {
+    TQTimer *traceTimer = new TQTimer(this);
+    connect(traceTimer, TQT_SIGNAL(timeout()), this, TQT_SLOT(flushTrace()));
+    traceTimer->start(1000);
+  }
+
+  m_captionTimer = new TQTimer(this);
+  connect(m_captionTimer, TQT_SIGNAL(timeout()), this,
+          TQT_SLOT(renderCaptions()));
+
+  m_menuBars = new MenuBarTable();
+  m_iconCache = new IconCache();
+
+  reset(0);
+}
+
+Q4Win10Handler::~Q4Win10Handler() {
+#ifdef Q4WIN10_PROFILE
+  Profiler::count(CountCaptionsCoalesced, m_captionsCoalesced);
+  Profiler::count(CountCaptionsDropped, m_captionsDropped);
+  Profiler::count(CountFrameSwaps, m_frameSwaps);
+  Profiler::count(CountFrameCacheDenied, m_frameCacheDenied);
+  Profiler::count(CountIconCacheHits, m_iconCache->hits());
+  Profiler::count(CountIconCacheMisses, m_iconCache->misses());
+  Profiler::dump();
+#endif
+  Tracer::shutdown();
+  Recorder::shutdown();
+  delete m_menuBars;
+  delete m_iconCache;
+  for (int t = 0; t < 2; ++t)
+    for (int s = 0; s < MaxScaleFactor; ++s)
+      delete m_titleMetrics[t][s];
 }
 
 bool Q4Win10Handler::reset(unsigned long changed) {
+  TraceScope trace("reloadConfig");
+
   // we assume the active font to be the same as the inactive font since the
   // control center doesn't offer different settings anyways.
-  m_titleFont = KDecoration::options()->font(true, false);    // not small
-  m_titleFontTool = KDecoration::options()->font(true, true); // small
+  m_titleFont[0] = KDecoration::options()->font(true, false);    // not small
+  m_titleFontTool[0] = KDecoration::options()->font(true, true); // small
+
+  // scaled variants for high-DPI screens
+  for (int s = 2; s <= MaxScaleFactor; ++s) {
+    m_titleFont[s - 1] = scaledFont(m_titleFont[0], s);
+    m_titleFontTool[s - 1] = scaledFont(m_titleFontTool[0], s);
+  }
+
+  // measuring a font is not free, share the metrics between all clients
+  for (int s = 0; s < MaxScaleFactor; ++s) {
+    delete m_titleMetrics[0][s];
+    delete m_titleMetrics[1][s];
+    m_titleMetrics[0][s] = new TitleMetrics(m_titleFont[s]);
+    m_titleMetrics[1][s] = new TitleMetrics(m_titleFontTool[s]);
+  }
 
   // Hardcode border size to normal (4px)
   m_borderSize = 4;
@@ -67,26 +163,10 @@ bool Q4Win10Handler::reset(unsigned long changed) {
 
   // read in the configuration
   readConfig();
+  updateTileFills();
 
   // pixmaps probably need to be updated, so delete the cache.
-  for (int t = 0; t < 2; ++t) {
-    for (int a = 0; a < 2; ++a) {
-      for (int i = 0; i < NumPixmaps; i++) {
-        if (m_pixmaps[t][a][i]) {
-          delete m_pixmaps[t][a][i];
-          m_pixmaps[t][a][i] = 0;
-        }
-      }
-    }
-  }
-  for (int t = 0; t < 2; ++t) {
-    for (int i = 0; i < NumButtonIcons; i++) {
-      if (m_bitmaps[t][i]) {
-        delete m_bitmaps[t][i];
-        m_bitmaps[t][i] = 0;
-      }
-    }
-  }
+  m_tileSets.clear();
 
   // Do we need to "hit the wooden hammer" ?
   bool needHardReset = true;
@@ -136,32 +216,202 @@ void Q4Win10Handler::readConfig() {
   config.reparseConfiguration(); // Ensure we have the latest values from disk
   config.setGroup("General");
 
-  // grab settings
+  // grab settings. Only DarkMode is in the configuration panel, the other
+  // keys are set by hand (README, Hidden Settings).
   // hardcoded defaults:
   // TitleShadow = false
-  // AnimateButtons = false
   // TitleAlign = Left
 
-  TQFontMetrics fm(m_titleFont); // active font = inactive font
   int titleHeightMin = config.readNumEntry("MinTitleHeight", 16);
-  // The title should strech with bigger font sizes!
-  m_titleHeight =
-      TQMAX(titleHeightMin, fm.height() + 4); // 4 px for the shadow etc.
-  // have an even title/button size so the button icons are fully centered...
-  if (m_titleHeight % 2 == 0)
-    m_titleHeight++;
-
-  fm = TQFontMetrics(m_titleFontTool); // active font = inactive font
   int titleHeightToolMin = config.readNumEntry("MinTitleHeightTool", 13);
-  // The title should strech with bigger font sizes!
-  m_titleHeightTool = TQMAX(titleHeightToolMin,
-                            fm.height()); // don't care about the shadow etc.
-  // have an even title/button size so the button icons are fully centered...
-  if (m_titleHeightTool % 2 == 0)
-    m_titleHeightTool++;
+
+  for (int s = 1; s <= MaxScaleFactor; ++s) {
+    // active font = inactive font
+    // The title should strech with bigger font sizes!
+    int h = TQMAX(titleHeightMin * s,
+                  titleMetrics(false, s).height() + 4); // 4 px for the shadow
+    // have an even title/button size so the button icons are fully
+    // centered...
+    if (h % 2 == 0)
+      h++;
+    m_titleHeight[s - 1] = h;
+
+    // The title should strech with bigger font sizes!
+    h = TQMAX(titleHeightToolMin * s,
+              titleMetrics(true, s).height()); // don't care about the shadow
+    // have an even title/button size so the button icons are fully
+    // centered...
+    if (h % 2 == 0)
+      h++;
+    m_titleHeightTool[s - 1] = h;
+  }
+
+  // 0 = pick the scale factor from the size of the screen a window is on
+  m_scaleFactor = config.readNumEntry("ScaleFactor", 0);
+  if (m_scaleFactor < 0 || m_scaleFactor > MaxScaleFactor)
+    m_scaleFactor = 0;
 
   m_darkMode =
       config.readBoolEntry("DarkMode", false); // Default to false (Light Mode)
+  // off by default, the hover used to snap without a timer
+  m_animateButtons = config.readBoolEntry("AnimateButtons", false);
+  // costs a pixmap per window on the server, pays off on remote X
+  m_bufferedTitleBar = config.readBoolEntry("BufferedTitleBar", false);
+  // KiB for title strips of both activation states, 0 = none
+  m_frameCacheSize = config.readNumEntry("FrameCacheSize", 8192);
+  if (m_frameCacheSize < 0)
+    m_frameCacheSize = 0;
+
+  // progress indicators retitle at 30-60 Hz, nobody reads that fast
+  m_maxCaptionRate = config.readNumEntry("MaxCaptionRate", 10);
+  if (m_maxCaptionRate < 0)
+    m_maxCaptionRate = 0;
+  // msec of caption rendering per idle batch, 0 = in the event handler
+  m_captionBudget = config.readNumEntry("CaptionBudget", 8);
+  if (m_captionBudget < 0)
+    m_captionBudget = 0;
+
+  // KiB of scaled application icons kept in ~/.cache, 0 = none
+  m_iconCache->setLimit(1024L * config.readNumEntry("IconCacheSize", 4096));
+  // from kdeglobals, the cached icons belong to a theme
+  config.setGroup("Icons");
+  m_iconCache->setTheme(config.readEntry("Theme", "default"));
+
+  // hover colors depend on the dark mode setting
+  m_hoverColorsValid = false;
+}
+
+const TQColor &Q4Win10Handler::hoverColor(uint step, bool active,
+                                         bool closeButton) {
+  if (!m_hoverColorsValid) {
+    for (int a = 0; a < 2; ++a) {
+      const TQColor base = getColor(TitleGradient3, a);
+
+      // Windows 10 Red
+      const TQColor closeColor(232, 17, 35);
+
+      // Use White for both Light and Dark modes to create a visible
+      // "highlight". Light Mode: Subtle highlight (lighter grey). Dark Mode:
+      // Visible highlight (lightened header).
+      // Opacity Settings (Alpha of Base Color)
+      // Light Mode (Classic): ~210/255 Base -> Subtle White overlay.
+      // Dark Mode: ~190/255 Base -> Stronger White overlay.
+      const TQColor normalColor =
+          alphaBlendColors(getColor(TitleGradient2, a), TQt::white,
+                           m_darkMode ? 190 : 210);
+
+      // fade from the titlebar color to the full hover color
+      for (uint i = 0; i <= ANIMATIONSTEPS; ++i) {
+        const int alpha = 255 - (int)(i * 255 / ANIMATIONSTEPS);
+        m_hoverColors[0][a][i] = alphaBlendColors(base, normalColor, alpha);
+        m_hoverColors[1][a][i] = alphaBlendColors(base, closeColor, alpha);
+      }
+    }
+    m_hoverColorsValid = true;
+  }
+
+  return m_hoverColors[closeButton][active][step];
+}
+
+void Q4Win10Handler::startAnimation(Q4Win10Button *button) {
+  if (!m_animatedButtons.containsRef(button))
+    m_animatedButtons.append(button);
+
+  if (!m_animationTimer->isActive())
+    m_animationTimer->start(TIMERINTERVAL);
+}
+
+void Q4Win10Handler::stopAnimation(Q4Win10Button *button) {
+  m_animatedButtons.removeRef(button);
+
+  if (m_animatedButtons.isEmpty())
+    m_animationTimer->stop();
+}
+
+void Q4Win10Handler::animationStep() {
+  TQPtrListIterator<Q4Win10Button> it(m_animatedButtons);
+  while (Q4Win10Button *button = it.current()) {
+    ++it;
+    if (!button->animate())
+      m_animatedButtons.removeRef(button);
+  }
+
+  // never tick while idle
+  if (m_animatedButtons.isEmpty())
+    m_animationTimer->stop();
+}
+
+void Q4Win10Handler::queueCaption(Q4Win10Client *client) {
+  if (m_captionBudget == 0) {
+    client->renderCaption();
+    return;
+  }
+
+  if (m_pendingCaptions.containsRef(client))
+    ++m_captionsCoalesced;
+  else
+    m_pendingCaptions.append(client);
+
+  // runs once the event queue is empty
+  if (!m_captionTimer->isActive())
+    m_captionTimer->start(0, true);
+}
+
+void Q4Win10Handler::dequeueCaption(Q4Win10Client *client) {
+  m_pendingCaptions.removeRef(client);
+
+  if (m_pendingCaptions.isEmpty())
+    m_captionTimer->stop();
+}
+
+int Q4Win10Handler::captionInterval(bool throttled) const {
+  if (m_maxCaptionRate == 0)
+    return 0;
+
+  // inactive and hidden windows are throttled four times harder
+  const int interval = 1000 / m_maxCaptionRate;
+  return throttled ? 4 * interval : interval;
+}
+
+bool Q4Win10Handler::reserveFrameCache(int bytes) {
+  if (m_frameCacheUsed + bytes > m_frameCacheSize * 1024) {
+    ++m_frameCacheDenied;
+    return false;
+  }
+
+  m_frameCacheUsed += bytes;
+  return true;
+}
+
+void Q4Win10Handler::flushTrace() { Tracer::flush(); }
+
+void Q4Win10Handler::renderCaptions() {
+  // a burst of retitles (tabbed terminals, dashboards) must not stall the
+  // window manager, so render within a budget and yield to events in between
+  TQTime budget;
+  budget.start();
+  while (Q4Win10Client *client = m_pendingCaptions.getFirst()) {
+    m_pendingCaptions.removeFirst();
+    client->renderCaption();
+    if (budget.elapsed() >= m_captionBudget)
+      break;
+  }
+
+  if (!m_pendingCaptions.isEmpty())
+    m_captionTimer->start(0, true);
+}
+
+int Q4Win10Handler::scaleFactor(int screen) const {
+  if (m_scaleFactor > 0)
+    return m_scaleFactor;
+
+  // 1080 rows is 100%, a 4K panel (2160 rows) gets 200%
+  int s = TQApplication::desktop()->screenGeometry(screen).height() / 1080;
+  if (s < 1)
+    s = 1;
+  else if (s > MaxScaleFactor)
+    s = MaxScaleFactor;
+  return s;
 }
 
 TQColor Q4Win10Handler::getColor(KWinQ4Win10::ColorType type,
@@ -208,15 +458,47 @@ TQColor Q4Win10Handler::getColor(KWinQ4Win10::ColorType type,
   }
 }
 
-void Q4Win10Handler::pretile(TQPixmap *&pix, int size,
-                             TQt::Orientation dir) const {
-  TQPixmap *newpix;
-  TQPainter p;
+Q4Win10Handler::TileSet *Q4Win10Handler::tileSet(const TileVariant &v) {
+  TileSet *set = m_tileSets.find(v.key());
+  if (!set) {
+    set = new TileSet();
+    m_tileSets.insert(v.key(), set);
+  }
+  return set;
+}
 
-  if (dir == TQt::Horizontal)
-    newpix = new TQPixmap(size, pix->height());
-  else
-    newpix = new TQPixmap(pix->width(), size);
+TQPixmap *Q4Win10Handler::createPixmap(int w, int h,
+                                       const TileVariant &v) const {
+  if (v.x11Screen == TQPaintDevice::x11AppScreen())
+    return new TQPixmap(w, h);
+
+  // a null pixmap takes the screen without a conversion
+  TQPixmap *pm = new TQPixmap();
+  pm->x11SetScreen(v.x11Screen);
+  pm->resize(w, h);
+  return pm;
+}
+
+// tiles are widened to this length so a paint needs fewer copies
+static const int TileLength = 64;
+
+// upper bound for the pretiled title bar top, 1 MB at 32 bpp
+static const int MaxTileArea = 256 * 1024;
+
+int Q4Win10Handler::pretileWidth(int height) const {
+  // long enough to cover a maximized window on the largest screen with one
+  // copy, never shorter than the other tiles
+  TQDesktopWidget *desktop = TQApplication::desktop();
+  int width = TileLength;
+  for (int i = 0; i < desktop->numScreens(); ++i)
+    width = TQMAX(width, desktop->screenGeometry(i).width());
+  return TQMIN(width, TQMAX(TileLength, MaxTileArea / TQMAX(height, 1)));
+}
+
+void Q4Win10Handler::pretile(TQPixmap *&pix, const TileVariant &v) const {
+  TQPixmap *newpix =
+      createPixmap(pretileWidth(pix->height()), pix->height(), v);
+  TQPainter p;
 
   p.begin(newpix);
   p.drawTiledPixmap(newpix->rect(), *pix);
@@ -226,79 +508,125 @@ void Q4Win10Handler::pretile(TQPixmap *&pix, int size,
   pix = newpix;
 }
 
+// The look of the uniform tiles. paintTile() draws them without a pixmap
+// and pixmap() builds their pixmaps from it, so this is the only place that
+// knows their colors.
+void Q4Win10Handler::updateTileFills() {
+  for (int a = 0; a < 2; ++a) {
+    for (int i = 0; i < NumPixmaps; ++i) {
+      m_tileFills[a][i].solid = false;
+      m_tileFills[a][i].edges = 0;
+    }
+
+    // the title bar is flat, its top and corner tiles are not
+    m_tileFills[a][TitleBarTile].solid = true;
+    m_tileFills[a][TitleBarTile].color = getColor(TitleGradient3, a);
+
+    // borders are window background with a 1px edge when inactive
+    const TQColor border = getColor(Border, a);
+    const Pixmaps borderTiles[] = {BorderLeftTile, BorderRightTile,
+                                   BorderBottomTile, BorderBottomLeft,
+                                   BorderBottomRight};
+    for (uint i = 0; i < sizeof(borderTiles) / sizeof(borderTiles[0]); ++i) {
+      m_tileFills[a][borderTiles[i]].solid = true;
+      m_tileFills[a][borderTiles[i]].color = border;
+    }
+    if (!a) {
+      m_tileFills[a][BorderLeftTile].edges = EdgeLeft;
+      m_tileFills[a][BorderRightTile].edges = EdgeRight;
+      m_tileFills[a][BorderBottomTile].edges = EdgeBottom;
+      m_tileFills[a][BorderBottomLeft].edges = EdgeLeft | EdgeBottom;
+      m_tileFills[a][BorderBottomRight].edges = EdgeRight | EdgeBottom;
+    }
+  }
+}
+
+void Q4Win10Handler::paintTile(TQPainter &painter, const TQRect &rect,
+                               Pixmaps type, bool active, bool toolWindow,
+                               const TileVariant &v) {
+  const TileFill &fill = m_tileFills[active][type];
+  if (!fill.solid) {
+    painter.drawTiledPixmap(rect, pixmap(type, active, toolWindow, v));
+    return;
+  }
+
+  // a rectangle fill and a line per edge instead of a pixmap copy, no
+  // server pixmap is needed for these tiles
+  painter.fillRect(rect, fill.color);
+  if (fill.edges) {
+    painter.setPen(edgeColor());
+    if (fill.edges & EdgeLeft)
+      painter.drawLine(rect.left(), rect.top(), rect.left(), rect.bottom());
+    if (fill.edges & EdgeRight)
+      painter.drawLine(rect.right(), rect.top(), rect.right(), rect.bottom());
+    if (fill.edges & EdgeBottom)
+      painter.drawLine(rect.left(), rect.bottom(), rect.right(),
+                       rect.bottom());
+  }
+}
+
+TQPixmap *Q4Win10Handler::fillTile(Pixmaps type, bool active, int w, int h,
+                                   const TileVariant &v) {
+  TQPixmap *pm = createPixmap(w, h, v);
+  TQPainter painter(pm);
+  paintTile(painter, pm->rect(), type, active, false, v);
+  painter.end();
+  return pm;
+}
+
 const TQPixmap &Q4Win10Handler::pixmap(Pixmaps type, bool active,
-                                       bool toolWindow) {
-  if (m_pixmaps[toolWindow][active][type])
-    return *m_pixmaps[toolWindow][active][type];
+                                       bool toolWindow, const TileVariant &v) {
+  Q4WIN10_PROFILE_SCOPE(ProfPixmap);
+
+  TQPixmap *&cached = tileSet(v)->pixmaps[toolWindow][active][type];
+  if (cached) {
+    Q4WIN10_PROBE4(pixmap_hit, type, active, toolWindow, v.key());
+    return *cached;
+  }
+  Q4WIN10_PROBE4(pixmap_miss, type, active, toolWindow, v.key());
+  TraceScope trace("buildTile");
+
+  const int scale = v.scale;
 
   TQPixmap *pm = 0;
 
   switch (type) {
-  case TitleBarTileTop:
-  case TitleBarTile: {
-    const int titleBarTileHeight =
-        (toolWindow ? m_titleHeightTool : m_titleHeight) + 2;
-    // gradient used as well in TitleBarTileTop as TitleBarTile
-    const int gradientHeight = 2 + titleBarTileHeight - 1;
-    TQPixmap gradient(1, gradientHeight);
-    TQPainter painter(&gradient);
-    // Windows 10 Style: Flat Color.
-    // Replace complex gradient with solid fill.
-    // Use TitleGradient2 (slightly darker) or TitleGradient3 (base color).
-    // Usually Windows 10 uses the base accent color.
-    painter.fillRect(gradient.rect(), getColor(TitleGradient3, active));
-    // (We leave the rest of the drawing logic, like top highlights, controlled
-    // by the next block)
+  case TitleBarTileTop: {
+    pm = createPixmap(1, 4, v);
+    TQPainter painter(pm);
+    // contour, uniformize the top edge of inactive windows with the others
+    painter.setPen(active ? getColor(WindowContour, active) : edgeColor());
+    painter.drawPoint(0, 0);
+    // top highlight
+    painter.setPen(getColor(ShadeTitleLight, active));
+    painter.drawPoint(0, 1);
+    // the flat title bar below
+    paintTile(painter, TQRect(0, 2, 1, 2), TitleBarTile, active, toolWindow,
+              v);
     painter.end();
 
-    // actual titlebar tiles
-    if (type == TitleBarTileTop) {
-      pm = new TQPixmap(1, 4);
-      painter.begin(pm);
-      // contour
-      if (active) {
-        painter.setPen(getColor(WindowContour, active));
-        painter.drawPoint(0, 0);
-      } else {
-        // Uniformize top edge with others
-        painter.setPen(m_darkMode ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
-        painter.drawPoint(0, 0);
-      }
-      // top highlight
-      painter.setPen(getColor(ShadeTitleLight, active));
-      painter.drawPoint(0, 1);
-      // gradient
-      painter.drawPixmap(0, 2, gradient);
-      painter.end();
-    } else {
-      pm = new TQPixmap(1, titleBarTileHeight);
-      painter.begin(pm);
-      painter.drawPixmap(0, 0, gradient, 0, 2);
-      painter.setPen(getColor(TitleGradient3, active));
-      painter.drawPoint(0, titleBarTileHeight - 1);
-      painter.end();
-    }
-
-    pretile(pm, 64, TQt::Horizontal);
+    // the only tile that is still copied from a pixmap on every paint
+    pretile(pm, v);
 
     break;
   }
 
   case TitleBarLeft: {
-    const int w = m_borderSize;
-    const int h = 4 + (toolWindow ? m_titleHeightTool : m_titleHeight) + 2;
+    const int w = borderSize(scale);
+    const int h =
+        4 + (toolWindow ? titleHeightTool(scale) : titleHeight(scale)) + 2;
 
-    pm = new TQPixmap(w, h);
+    pm = createPixmap(w, h, v);
     TQPainter painter(pm);
 
     painter.drawTiledPixmap(0, 0, w, 4,
-                            pixmap(TitleBarTileTop, active, toolWindow));
+                            pixmap(TitleBarTileTop, active, toolWindow, v));
     painter.drawTiledPixmap(0, 4, w, h - 4,
-                            pixmap(TitleBarTile, active, toolWindow));
+                            pixmap(TitleBarTile, active, toolWindow, v));
 
     // Seamless: No contours or highlights in title segments
     if (!active) {
-      painter.setPen(m_darkMode ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
+      painter.setPen(edgeColor());
       painter.drawLine(0, 0, 0, h);
     }
 
@@ -312,20 +640,21 @@ const TQPixmap &Q4Win10Handler::pixmap(Pixmaps type, bool active,
   }
 
   case TitleBarRight: {
-    const int w = m_borderSize;
-    const int h = 4 + (toolWindow ? m_titleHeightTool : m_titleHeight) + 2;
+    const int w = borderSize(scale);
+    const int h =
+        4 + (toolWindow ? titleHeightTool(scale) : titleHeight(scale)) + 2;
 
-    pm = new TQPixmap(w, h);
+    pm = createPixmap(w, h, v);
     TQPainter painter(pm);
 
     painter.drawTiledPixmap(0, 0, w, 4,
-                            pixmap(TitleBarTileTop, active, toolWindow));
+                            pixmap(TitleBarTileTop, active, toolWindow, v));
     painter.drawTiledPixmap(0, 4, w, h - 4,
-                            pixmap(TitleBarTile, active, toolWindow));
+                            pixmap(TitleBarTile, active, toolWindow, v));
 
     // Seamless: No contours or highlights in title segments
     if (!active) {
-      painter.setPen(m_darkMode ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
+      painter.setPen(edgeColor());
       painter.drawLine(w - 1, 0, w - 1, h);
     }
 
@@ -338,128 +667,42 @@ const TQPixmap &Q4Win10Handler::pixmap(Pixmaps type, bool active,
     break;
   }
 
-  case BorderLeftTile: {
-    const int w = m_borderSize;
-
-    pm = new TQPixmap(w, 1);
-    TQPainter painter(pm);
-
-    // Dynamic Inactive Border Logic (Seamless 4px)
-    if (active) {
-      painter.fillRect(0, 0, w, 1, getColor(Border, active));
-    } else {
-      // 1px gray edge on the outside, rest is window background
-      painter.fillRect(0, 0, w, 1, getColor(Border, active));
-      painter.setPen(m_darkMode ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
-      painter.drawPoint(0, 0); // Outside edge is at x=0
-    }
-
-    painter.end();
-
-    pretile(pm, 64, TQt::Vertical);
-
-    break;
-  }
-
-  case BorderRightTile: {
-    const int w = m_borderSize;
-
-    pm = new TQPixmap(w, 1);
-    TQPainter painter(pm);
-
-    // Dynamic Inactive Border Logic (Seamless 4px)
-    if (active) {
-      painter.fillRect(0, 0, w, 1, getColor(Border, active));
-    } else {
-      // 1px gray edge on the outside, rest is window background
-      painter.fillRect(0, 0, w, 1, getColor(Border, active));
-      painter.setPen(m_darkMode ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
-      painter.drawPoint(w - 1, 0); // Outside edge is at x=w-1
-    }
-
-    painter.end();
-
-    pretile(pm, 64, TQt::Vertical);
-
+  // uniform tiles, drawn from their description in m_tileFills. paintTile()
+  // fills them directly, their pixmaps only serve the tiles composed from
+  // them and the button backgrounds.
+  case TitleBarTile: {
+    const int h = toolWindow ? titleHeightTool(scale) : titleHeight(scale);
+    pm = fillTile(type, active, TileLength, h + 2, v);
     break;
   }
 
-  case BorderBottomLeft: {
-    const int w = m_borderSize;
-    const int h = m_borderSize;
-
-    pm = new TQPixmap(w, h);
-    TQPainter painter(pm);
-
-    // Dynamic Inactive Border Logic (Seamless 4px)
-    if (active) {
-      painter.fillRect(0, 0, w, h, getColor(Border, active));
-    } else {
-      // 1px gray edge on the outside, rest is window background
-      painter.fillRect(0, 0, w, h, getColor(Border, active));
-      painter.setPen(m_darkMode ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
-      painter.drawLine(0, 0, 0, h - 1);         // Left edge
-      painter.drawLine(0, h - 1, w - 1, h - 1); // Bottom edge
-    }
-
-    painter.end();
-
+  case BorderLeftTile:
+  case BorderRightTile:
+    pm = fillTile(type, active, borderSize(scale), TileLength, v);
     break;
-  }
-
-  case BorderBottomRight: {
-    const int w = m_borderSize;
-    const int h = m_borderSize;
-
-    pm = new TQPixmap(w, h);
-    TQPainter painter(pm);
-
-    // Dynamic Inactive Border Logic (Seamless 4px)
-    if (active) {
-      painter.fillRect(0, 0, w, h, getColor(Border, active));
-    } else {
-      // 1px gray edge on the outside, rest is window background
-      painter.fillRect(0, 0, w, h, getColor(Border, active));
-      painter.setPen(m_darkMode ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
-      painter.drawLine(w - 1, 0, w - 1, h - 1); // Right edge
-      painter.drawLine(0, h - 1, w - 1, h - 1); // Bottom edge
-    }
-
-    painter.end();
 
+  case BorderBottomLeft:
+  case BorderBottomRight:
+    pm = fillTile(type, active, borderSize(scale), borderSize(scale), v);
     break;
-  }
 
   case BorderBottomTile:
-  default: {
-    const int h = m_borderSize;
-
-    pm = new TQPixmap(1, m_borderSize);
-    TQPainter painter(pm);
-
-    if (active) {
-      painter.fillRect(0, 0, 1, h, getColor(Border, active));
-    } else {
-      // 1px gray edge on the bottom, rest is window background
-      painter.fillRect(0, 0, 1, h, getColor(Border, active));
-      painter.setPen(m_darkMode ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
-      painter.drawPoint(0, h - 1); // Bottom edge is at y=h-1
-    }
-    painter.end();
-
-    pretile(pm, 64, TQt::Horizontal);
-
+  default:
+    pm = fillTile(type, active, TileLength, borderSize(scale), v);
     break;
   }
-  }
 
-  m_pixmaps[toolWindow][active][type] = pm;
+  trace.setSize(pm->width(), pm->height());
+  cached = pm;
   return *pm;
 }
 
 const TQBitmap &Q4Win10Handler::buttonBitmap(ButtonIcon type,
                                              const TQSize &size,
-                                             bool toolWindow) {
+                                             bool toolWindow,
+                                             const TileVariant &v) {
+  Q4WIN10_PROFILE_SCOPE(ProfButtonBitmap);
+
   int typeIndex = type;
 
   // btn icon size...
@@ -476,18 +719,24 @@ const TQBitmap &Q4Win10Handler::buttonBitmap(ButtonIcon type,
   int w = size.width() - reduceW;
   int h = size.height() - reduceH;
 
-  if (m_bitmaps[toolWindow][typeIndex] &&
-      m_bitmaps[toolWindow][typeIndex]->size() == TQSize(w, h))
-    return *m_bitmaps[toolWindow][typeIndex];
+  TQBitmap *&cached = tileSet(v)->bitmaps[toolWindow][typeIndex];
+  if (cached && cached->size() == TQSize(w, h)) {
+    Q4WIN10_PROBE4(bitmap_hit, type, w, h, v.key());
+    return *cached;
+  }
+  Q4WIN10_PROBE4(bitmap_miss, type, w, h, v.key());
+  TraceScope trace("buildGlyph", 0, w, h);
 
   // no matching pixmap found, create a new one...
 
-  delete m_bitmaps[toolWindow][typeIndex];
-  m_bitmaps[toolWindow][typeIndex] = 0;
+  delete cached;
+  cached = 0;
 
   TQBitmap bmp = IconEngine::icon(type /*icon*/, TQMIN(w, h));
   TQBitmap *bitmap = new TQBitmap(bmp);
-  m_bitmaps[toolWindow][typeIndex] = bitmap;
+  if (bitmap->x11Screen() != v.x11Screen)
+    bitmap->x11SetScreen(v.x11Screen);
+  cached = bitmap;
   return *bitmap;
 }
 
@@ -25,12 +25,24 @@
 
 #include <tqcolor.h>
 #include <tqfont.h>
+#include <tqfontmetrics.h>
+#include <tqintdict.h>
+#include <tqptrlist.h>
 
 #include <kdecoration.h>
 #include <kdecorationfactory.h>
 
+class TQPainter;
+class TQTimer;
+
 namespace KWinQ4Win10 {
 
+class Q4Win10Button;
+class Q4Win10Client;
+class MenuBarTable;
+class IconCache;
+class HarnessAccess;
+
 inline TQColor hsvRelative(const TQColor &baseColor, int relativeH,
                            int relativeS, int relativeV) {
   int h, s, v;
@@ -115,6 +127,70 @@ enum ButtonIcon {
   NumButtonIcons
 };
 
+// what changed since the last paint of a decoration or button
+enum DirtyFlags {
+  DirtyCaption = 1 << 0,
+  DirtyActive = 1 << 1,
+  DirtyIcon = 1 << 2,
+  DirtyGeometry = 1 << 3,
+  DirtyPalette = 1 << 4,
+  DirtyMenuBar = 1 << 5,
+  DirtyButtonState = 1 << 6,
+  DirtyAll = (1 << 7) - 1
+};
+
+// 1px edges of a solid tile, drawn in edgeColor()
+enum TileEdge { EdgeLeft = 1 << 0, EdgeRight = 1 << 1, EdgeBottom = 1 << 2 };
+
+// Pixel-exact details of the Win10 look, shared by all paint paths.
+// buttons reach 3px up into the top edge without covering the 1px inactive
+// border line
+static const int ButtonMarginTop = -3;
+// caption text baseline, relative to the font height
+static const int CaptionBaselineOffset = 4;
+// the base colored side border section ends 2px above the menubar bottom
+static const int MenuBarBorderOffset = 2;
+
+// integer scale factors for high-DPI screens (1 = 100%)
+enum { MaxScaleFactor = 3 };
+
+// what the cached pixmaps of a window depend on besides its state: a tile
+// made for one X screen is converted by the server, or fails to copy, on
+// another. TQt creates pixmaps only in the default depth of their screen,
+// which is the depth of every widget on it, so the screen implies the depth.
+struct TileVariant {
+  TileVariant() : scale(1), x11Screen(TQPaintDevice::x11AppScreen()) {}
+  bool operator==(const TileVariant &o) const {
+    return scale == o.scale && x11Screen == o.x11Screen;
+  }
+  bool operator!=(const TileVariant &o) const { return !(*this == o); }
+  long key() const { return (x11Screen << 8) | scale; }
+
+  int scale;
+  int x11Screen;
+};
+
+// hover fade animation
+static const uint TIMERINTERVAL = 50; // msec
+static const uint ANIMATIONSTEPS = 4;
+
+// Metrics of a title font. Advances of Latin-1 characters are kept in a
+// table, so captions are measured without going through the font engine.
+class TitleMetrics {
+public:
+  TitleMetrics(const TQFont &font);
+
+  const TQFontMetrics &metrics() const { return m_metrics; }
+  int height() const { return m_height; }
+  // -1 for characters outside the table
+  int advance(const TQChar &c);
+
+private:
+  TQFontMetrics m_metrics;
+  int m_height;
+  short m_advances[256]; // -1 = not measured yet
+};
+
 class Q4Win10Handler : public TQObject, public KDecorationFactory {
   TQ_OBJECT
 public:
@@ -125,45 +201,139 @@ public:
   virtual KDecoration *createDecoration(KDecorationBridge *);
   virtual bool supports(Ability ability);
 
-  const TQPixmap &pixmap(Pixmaps type, bool active, bool toolWindow);
+  const TQPixmap &pixmap(Pixmaps type, bool active, bool toolWindow,
+                        const TileVariant &v);
   const TQBitmap &buttonBitmap(ButtonIcon type, const TQSize &size,
-                               bool toolWindow);
+                               bool toolWindow, const TileVariant &v);
+  // draws a tile, with plain fills and lines when its content is uniform
+  void paintTile(TQPainter &painter, const TQRect &rect, Pixmaps type,
+                 bool active, bool toolWindow, const TileVariant &v);
+  // an empty pixmap on the screen of the variant
+  TQPixmap *createPixmap(int w, int h, const TileVariant &v) const;
 
-  int titleHeight() { return m_titleHeight; }
-  int titleHeightTool() { return m_titleHeightTool; }
-  const TQFont &titleFont() { return m_titleFont; }
-  const TQFont &titleFontTool() { return m_titleFontTool; }
+  int titleHeight(int scale = 1) { return m_titleHeight[scale - 1]; }
+  int titleHeightTool(int scale = 1) { return m_titleHeightTool[scale - 1]; }
+  const TQFont &titleFont(int scale = 1) { return m_titleFont[scale - 1]; }
+  const TQFont &titleFontTool(int scale = 1) {
+    return m_titleFontTool[scale - 1];
+  }
+  TitleMetrics &titleMetrics(bool toolWindow, int scale = 1) {
+    return *m_titleMetrics[toolWindow][scale - 1];
+  }
   bool titleShadow() { return false; }
-  int borderSize() { return m_borderSize; }
-  bool animateButtons() { return false; }
+  int borderSize(int scale = 1) { return m_borderSize * scale; }
+  int scaleFactor(int screen) const;
+  bool animateButtons() { return m_animateButtons; }
+  // compose the title strip offscreen and copy it with one request
+  bool bufferedTitleBar() { return m_bufferedTitleBar; }
+  // memory for prerendered active and inactive title strips, shared by all
+  // windows; false when the FrameCacheSize budget is used up
+  bool reserveFrameCache(int bytes);
+  void releaseFrameCache(int bytes) { m_frameCacheUsed -= bytes; }
+  // a focus change that only had to copy a prerendered strip
+  void frameSwapped() { ++m_frameSwaps; }
   bool menuClose() { return true; } // Hardcoded to true
   bool darkMode() { return m_darkMode; }
   TQt::AlignmentFlags titleAlign() { return TQt::AlignLeft; }
   bool reverseLayout() { return m_reverse; }
   TQColor getColor(KWinQ4Win10::ColorType type, const bool active = true);
+  // 1px grey outer edge of inactive windows
+  TQColor edgeColor() const {
+    return m_darkMode ? TQColor(90, 90, 90) : TQColor(170, 170, 170);
+  }
+  MenuBarTable *menuBars() { return m_menuBars; }
+  IconCache *iconCache() { return m_iconCache; }
 
   TQValueList<Q4Win10Handler::BorderSize> borderSizes() const;
   void readConfig();
 
+  // hover background for each animation step, 0 = no hover
+  const TQColor &hoverColor(uint step, bool active, bool closeButton);
+  void startAnimation(Q4Win10Button *button);
+  void stopAnimation(Q4Win10Button *button);
+
+  // new captions are rendered in idle batches, the old one stays visible
+  // until then
+  void queueCaption(Q4Win10Client *client);
+  void dequeueCaption(Q4Win10Client *client);
+  // minimum msec between two caption renders of a window, 0 = unlimited
+  int captionInterval(bool throttled) const;
+  // intermediate titles merged in the queue or superseded while throttled
+  unsigned long captionsCoalesced() const { return m_captionsCoalesced; }
+  unsigned long captionsDropped() const { return m_captionsDropped; }
+  void captionDropped() { ++m_captionsDropped; }
+
+private slots:
+  void animationStep();
+  void renderCaptions();
+  void flushTrace();
+
 private:
-  void pretile(TQPixmap *&pix, int size, TQt::Orientation dir) const;
+  friend class HarnessAccess; // tests/ clears the caches between runs
+
+  // widens a horizontal tile to the largest screen, see pretileWidth()
+  void pretile(TQPixmap *&pix, const TileVariant &v) const;
+  int pretileWidth(int height) const;
+  void updateTileFills();
+  // a pixmap of a tile with a solid TileFill
+  TQPixmap *fillTile(Pixmaps type, bool active, int w, int h,
+                     const TileVariant &v);
 
-  // Removed unused members: m_coloredBorder, m_titleShadow, m_animateButtons,
-  // m_menuClose
+  // Removed unused members: m_coloredBorder, m_titleShadow, m_menuClose
 
   bool m_darkMode;
   bool m_reverse;
+  bool m_animateButtons;
+  bool m_bufferedTitleBar;
+  int m_frameCacheSize; // KiB
+  int m_frameCacheUsed; // bytes
+  unsigned long m_frameSwaps;
+  unsigned long m_frameCacheDenied;
   int m_borderSize;
-  int m_titleHeight;
-  int m_titleHeightTool;
-  TQFont m_titleFont;
-  TQFont m_titleFontTool;
+  int m_scaleFactor; // 0 = derived from the screen size
+  int m_maxCaptionRate; // Hz per window, 0 = unlimited
+  int m_captionBudget;  // msec per idle batch, 0 = render right away
+  int m_titleHeight[MaxScaleFactor];
+  int m_titleHeightTool[MaxScaleFactor];
+  TQFont m_titleFont[MaxScaleFactor];
+  TQFont m_titleFontTool[MaxScaleFactor];
+  TitleMetrics *m_titleMetrics[2][MaxScaleFactor]; // [toolWindow][scale - 1]
   TQt::AlignmentFlags m_titleAlign;
 
-  // pixmap cache
-  TQPixmap *m_pixmaps[2][2][NumPixmaps]; // button pixmaps have normal+pressed
-                                         // state...
-  TQBitmap *m_bitmaps[2][NumButtonIcons];
+  // pixmap cache, one tile set per TileVariant in use
+  struct TileSet {
+    TileSet();
+    ~TileSet();
+    TQPixmap *pixmaps[2][2][NumPixmaps];
+    TQBitmap *bitmaps[2][NumButtonIcons];
+  };
+  TileSet *tileSet(const TileVariant &v);
+  TQIntDict<TileSet> m_tileSets;
+
+  // solid description of each tile, see updateTileFills()
+  struct TileFill {
+    bool solid;
+    TQColor color;
+    int edges; // TileEdge
+  };
+  TileFill m_tileFills[2][NumPixmaps];
+
+  // precomputed hover fade frames [closeButton][active][step]
+  TQColor m_hoverColors[2][2][ANIMATIONSTEPS + 1];
+  bool m_hoverColorsValid;
+
+  // one timer drives all animated buttons, it only runs while the list is
+  // not empty
+  TQTimer *m_animationTimer;
+  TQPtrList<Q4Win10Button> m_animatedButtons;
+
+  TQTimer *m_captionTimer;
+  TQPtrList<Q4Win10Client> m_pendingCaptions;
+  unsigned long m_captionsCoalesced;
+  unsigned long m_captionsDropped;
+
+  MenuBarTable *m_menuBars;
+  IconCache *m_iconCache;
 };
 
 Q4Win10Handler *Handler();
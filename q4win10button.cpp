@@ -25,7 +25,6 @@
 #include <kpixmap.h>
 #include <kpixmapeffect.h>
 #include <tqbitmap.h>
-#include <tqcursor.h>
 #include <tqpainter.h>
 #include <tqpixmap.h>
 #include <tqtimer.h>
@@ -33,16 +32,17 @@
 #include "q4win10button.h"
 #include "q4win10button.moc"
 #include "q4win10client.h"
+#include "q4win10iconcache.h"
+#include "q4win10profile.h"
+#include "q4win10trace.h"
 
 namespace KWinQ4Win10 {
 
-static const uint TIMERINTERVAL = 50; // msec
-static const uint ANIMATIONSTEPS = 4;
-
 Q4Win10Button::Q4Win10Button(ButtonType type, Q4Win10Client *parent,
                              const char *name)
     : KCommonDecorationButton(type, parent, name), m_client(parent),
-      m_iconType(NumButtonIcons), hover(false) {
+      m_iconType(NumButtonIcons), hover(false), m_animProgress(0),
+      m_dirty(DirtyAll) {
   setBackgroundMode(NoBackground);
 
   // no need to reset here as the button will be resetted on first resize.
@@ -50,11 +50,20 @@ Q4Win10Button::Q4Win10Button(ButtonType type, Q4Win10Client *parent,
   // no need to reset here as the button will be resetted on first resize.
 }
 
-Q4Win10Button::~Q4Win10Button() {}
+Q4Win10Button::~Q4Win10Button() { Handler()->stopAnimation(this); }
 
 void Q4Win10Button::reset(unsigned long changed) {
-  if (changed & DecorationReset || changed & ManualReset ||
-      changed & SizeChange || changed & StateChange) {
+  // record what changed, drawButton() only redoes that work
+  if (changed & DecorationReset || changed & ManualReset)
+    m_dirty |= DirtyAll;
+  if (changed & SizeChange)
+    m_dirty |= DirtyGeometry;
+  if (changed & StateChange || changed & ToggleChange)
+    m_dirty |= DirtyButtonState;
+  if (changed & IconChange)
+    m_dirty |= DirtyIcon;
+
+  if (m_dirty & (DirtyGeometry | DirtyButtonState)) {
     switch (type()) {
     case CloseButton:
       m_iconType = CloseIcon;
@@ -106,39 +115,85 @@ void Q4Win10Button::reset(unsigned long changed) {
     }
 
     // Fix: Sanitize hover state on state changes (e.g. Maximize/Restore).
-    if (isVisible()) {
-      bool actualHover =
-          this->rect().contains(this->mapFromGlobal(TQCursor::pos()));
-      if (hover != actualHover) {
-        hover = actualHover;
-        this->repaint(false);
-      }
-    }
+    // The client queries the pointer once for all of its buttons.
+    if (isVisible())
+      m_client->scheduleHoverSync();
 
+    this->update();
+  } else if (m_dirty & DirtyIcon) {
     this->update();
   }
-  // Invalidate cache on reset/changes
-  m_scaledMenuIcon = TQPixmap();
+}
+
+void Q4Win10Button::setHover(bool h) {
+  if (hover == h)
+    return;
+
+  hover = h;
+  // snap to the new state, no fading on state changes
+  m_animProgress = hover ? ANIMATIONSTEPS : 0;
+  Handler()->stopAnimation(this);
+  update();
 }
 
 void Q4Win10Button::enterEvent(TQEvent *e) {
+  Q4WIN10_REQUEST_SCOPE(OpHover);
   TQButton::enterEvent(e);
   hover = true;
-  repaint(false);
+  if (Handler()->animateButtons() && type() != MenuButton) {
+    Handler()->startAnimation(this);
+  } else {
+    m_animProgress = ANIMATIONSTEPS;
+    repaint(false);
+  }
 }
 
 void Q4Win10Button::leaveEvent(TQEvent *e) {
+  Q4WIN10_REQUEST_SCOPE(OpHover);
   TQButton::leaveEvent(e);
   hover = false;
+  if (Handler()->animateButtons() && type() != MenuButton) {
+    Handler()->startAnimation(this);
+  } else {
+    m_animProgress = 0;
+    repaint(false);
+  }
+}
+
+bool Q4Win10Button::animate() {
+  if (hover && m_animProgress < ANIMATIONSTEPS) {
+    ++m_animProgress;
+  } else if (!hover && m_animProgress > 0) {
+    --m_animProgress;
+  } else {
+    return false;
+  }
+
   repaint(false);
+  return hover ? m_animProgress < ANIMATIONSTEPS : m_animProgress > 0;
 }
 
 void Q4Win10Button::drawButton(TQPainter *painter) {
+  Q4WIN10_PROFILE_SCOPE(ProfDrawButton);
+  TraceScope trace("drawButton", m_client->windowId(), width(), height());
+  Q4WIN10_PROBE4(button_start, m_client->windowId(), type(), width(),
+                 height());
+
   TQRect r(0, 0, width(), height());
 
   bool active = m_client->isActive();
   KPixmap tempKPixmap;
 
+  // a focus change copies the face of the new state if it is known
+  const bool resting = m_animProgress == 0 && !isDown();
+  if (m_dirty || !m_client->prerenderedFrames())
+    m_faces[0] = m_faces[1] = TQPixmap();
+  if (resting && !m_faces[active].isNull()) {
+    painter->drawPixmap(0, 0, m_faces[active]);
+    Q4WIN10_PROBE2(button_done, m_client->windowId(), type());
+    return;
+  }
+
   // Windows 10 Style: No calculation of contour/surface colors needed.
   // We use direct simple colors later.
 
@@ -150,35 +205,22 @@ void Q4Win10Button::drawButton(TQPainter *painter) {
   bP.drawTiledPixmap(0, 0, width(), width(), m_client->getTitleBarTile(active));
 
   // Determine if we should draw the background highlight
-  // Reverting to standard "hover" logic as requested.
-  // Original Plastik relies on enterEvent/leaveEvent setting 'hover'.
+  // Original Plastik relies on enterEvent/leaveEvent setting 'hover', the
+  // fade animation moves m_animProgress towards it.
   // Fix: Menu Button (App Icon) should NOT have hover effect.
-  bool showBackground = hover && (type() != MenuButton);
+  bool showBackground = m_animProgress > 0 && (type() != MenuButton);
 
   if (showBackground) {
-    TQColor bgColor;
-    if (type() == CloseButton) {
-      bgColor = TQColor(232, 17, 35); // Windows 10 Red
-    } else {
-      // Restore Original "Light Mode" Logic + Dark Mode Enhancement
-      TQColor baseColor = Handler()->getColor(TitleGradient2, active);
-
-      // Fix: Use White for both Light and Dark modes to create a visible
-      // "highlight". Light Mode: Subtle highlight (lighter grey). Dark Mode:
-      // Visible highlight (lightened header).
-      TQColor overlayColor = TQt::white;
-
-      // Opacity Settings (Alpha of Base Color)
-      // Light Mode (Classic): ~210/255 Base -> Subtle White overlay.
-      // Dark Mode: ~190/255 Base -> Stronger White overlay.
-      int alpha = Handler()->darkMode() ? 190 : 210;
-
-      bgColor = alphaBlendColors(baseColor, overlayColor, alpha);
-    }
-    bP.fillRect(r, bgColor);
+    // precomputed blend between titlebar and hover color
+    bP.fillRect(r, Handler()->hoverColor(m_animProgress, active,
+                                         type() == CloseButton));
   }
 
   if (type() == MenuButton) {
+    // Invalidate cache when the application icon changed
+    if (m_dirty & DirtyIcon)
+      m_scaledMenuIcon = TQPixmap();
+
     // Calculate square size to preserve aspect ratio
     int s = TQMIN(width(), height()) - 6; // -6 for reduced size (more padding)
     if (s < 1)
@@ -189,16 +231,19 @@ void Q4Win10Button::drawButton(TQPainter *painter) {
         m_scaledMenuIcon.height() != s) {
       TQPixmap menuIcon(
           m_client->icon().pixmap(TQIconSet::Large, TQIconSet::Normal));
-      m_scaledMenuIcon.convertFromImage(
-          TQImage(menuIcon.convertToImage()).smoothScale(s, s));
+      // scaled in an earlier session most of the time
+      m_scaledMenuIcon = Handler()->iconCache()->scaledIcon(
+          m_client->windowId(), m_client->iconKey(), menuIcon, s);
     }
 
     bP.drawPixmap((width() - m_scaledMenuIcon.width()) / 2,
                   (height() - m_scaledMenuIcon.height()) / 2, m_scaledMenuIcon);
   } else {
     int dX, dY;
-    const TQBitmap &icon = Handler()->buttonBitmap(
-        m_iconType, size(), decoration()->isToolWindow());
+    const TQBitmap &icon =
+        Handler()->buttonBitmap(m_iconType, size(),
+                                decoration()->isToolWindow(),
+                                m_client->tileVariant());
     dX = r.x() + (r.width() - icon.width()) / 2;
     dY = r.y() + (r.height() - icon.height()) / 2;
     if (isDown()) {
@@ -225,7 +270,9 @@ void Q4Win10Button::drawButton(TQPainter *painter) {
     }
 
     // Special Case: Close Button on Hover/Down
-    if (type() == CloseButton && (showBackground || isDown())) {
+    if (type() == CloseButton &&
+        ((showBackground && m_animProgress * 2 >= ANIMATIONSTEPS) ||
+         isDown())) {
       iconColor = TQt::white;
     }
 
@@ -235,9 +282,16 @@ void Q4Win10Button::drawButton(TQPainter *painter) {
 
   bP.end();
   painter->drawPixmap(0, 0, buffer);
+  if (resting && m_client->prerenderedFrames())
+    m_faces[active] = buffer;
+
+  m_dirty = 0;
+  Q4WIN10_PROBE2(button_done, m_client->windowId(), type());
 }
 
 TQBitmap IconEngine::icon(ButtonIcon icon, int size) {
+  Q4WIN10_PROFILE_SCOPE(ProfIconEngine);
+
   if (size % 2 == 0)
     --size;
 
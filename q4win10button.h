@@ -44,6 +44,11 @@ public:
   void reset(unsigned long changed);
   Q4Win10Client *client() { return m_client; }
 
+  // advance the hover fade by one step, returns false when it is finished
+  bool animate();
+  // set the hover state without fading, e.g. after a state change
+  void setHover(bool h);
+
 private:
   void enterEvent(TQEvent *e);
   void leaveEvent(TQEvent *e);
@@ -53,7 +58,10 @@ private:
   Q4Win10Client *m_client;
   ButtonIcon m_iconType;
   bool hover;
+  uint m_animProgress; // 0 (no hover) .. ANIMATIONSTEPS (full hover)
+  unsigned int m_dirty; // DirtyFlags
   TQPixmap m_scaledMenuIcon;
+  TQPixmap m_faces[2]; // [active] without hover, see prerenderedFrames()
 };
 
 /**
@@ -22,6 +22,7 @@
 
 #include <tdelocale.h>
 
+#include <tqapplication.h>
 #include <tqbitmap.h>
 #include <tqdatetime.h>
 #include <tqdesktopwidget.h>
@@ -31,49 +32,56 @@
 #include <tqlayout.h>
 #include <tqpainter.h>
 #include <tqpixmap.h>
+#include <tqtimer.h>
 
 #include "q4win10button.h"
 #include "q4win10client.h"
+#include "q4win10client.moc"
+#include "q4win10iconcache.h"
+#include "q4win10menubar.h"
+#include "q4win10profile.h"
+#include "q4win10record.h"
+#include "q4win10trace.h"
 
-#include <X11/Xlib.h>
-#include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
+#include <stdlib.h>
+#include <xcb/xcb.h>
 
 namespace KWinQ4Win10 {
 
-// Helper to read X11 property from Style Plugin
-static int getMenuBarHeight(WId winId) {
-    if (!winId) return 0;
-    Display *dpy = tqt_xdisplay();
-    Atom atom = XInternAtom(dpy, "_Q4WIN10_MENUBAR_HEIGHT", True);
-    if (atom == None) return 0;
-
-    Atom actualType;
-    int actualFormat;
-    unsigned long nitems;
-    unsigned long bytesAfter;
-    unsigned char *prop = 0;
-    int height = 0;
-
-    if (XGetWindowProperty(dpy, winId, atom, 0, 1, False, XA_CARDINAL,
-                           &actualType, &actualFormat, &nitems, &bytesAfter,
-                           &prop) == Success) {
-        if (prop) {
-            if (actualType == XA_CARDINAL && actualFormat == 32 && nitems > 0) {
-                height = (int)*(long *)prop;
-            }
-            XFree(prop);
-        }
-    }
-    return height;
-}
-
 Q4Win10Client::Q4Win10Client(KDecorationBridge *bridge,
                              KDecorationFactory *factory)
-    : KCommonDecoration(bridge, factory), s_titleFont(TQFont()) {
+    : KCommonDecoration(bridge, factory), m_hoverSyncPending(false),
+      m_pointerRequest(0), m_classRequest(0), m_iconRequest(0),
+      m_dirty(DirtyAll), m_menuBarHeight(0),
+      m_frameCacheBytes(0) {
   memset(m_captionPixmaps, 0, sizeof(TQPixmap *) * 2);
+  memset(m_titleBuffer, 0, sizeof(TQPixmap *) * 2);
+  invalidateTitleBuffers();
+  invalidateFrameMetrics();
+
+  m_captionThrottle = new TQTimer(this);
+  connect(m_captionThrottle, TQT_SIGNAL(timeout()), this,
+          TQT_SLOT(flushCaption()));
+
+  m_prerenderTimer = new TQTimer(this);
+  connect(m_prerenderTimer, TQT_SIGNAL(timeout()), this,
+          TQT_SLOT(prerenderFrame()));
 }
 
-Q4Win10Client::~Q4Win10Client() { clearCaptionPixmaps(); }
+Q4Win10Client::~Q4Win10Client() {
+  Recorder::record(RecDestroy, windowId());
+  if (m_hoverSyncPending)
+    xcb_discard_reply(XGetXCBConnection(tqt_xdisplay()), m_pointerRequest);
+  if (m_classRequest)
+    IconCache::discard(m_classRequest);
+  if (m_iconRequest)
+    IconCache::discard(m_iconRequest);
+  Handler()->menuBars()->removeClient(windowId());
+  Handler()->dequeueCaption(this);
+  clearCaptionPixmaps();
+  releaseTitleBuffers();
+}
 
 TQString Q4Win10Client::visibleName() const { return i18n("Q4Win10"); }
 
@@ -94,88 +102,99 @@ bool Q4Win10Client::decorationBehaviour(DecorationBehaviour behaviour) const {
   }
 }
 
+// Frame geometry of a window state. The specialized paint paths call these
+// with compile-time constants, so the branches fold away there.
+static inline int frameBorder(bool maximized, int scale) {
+  return maximized ? 0 : Handler()->borderSize(scale);
+}
+
+static inline int frameTitleEdgeTop(bool maximized) {
+  return maximized ? 0 : 4;
+}
+
+static const int FrameTitleEdgeBottom = 2;
+
+static inline int frameTitleEdgeSide(bool maximized) {
+  return maximized ? 0 : 1; // Minimal margin to shift menu icon left
+}
+
+static inline int frameTitleHeight(bool toolWindow, int scale) {
+  return toolWindow ? Handler()->titleHeightTool(scale)
+                    : Handler()->titleHeight(scale);
+}
+
+bool Q4Win10Client::isFullyMaximized() const {
+  return maximizeMode() == MaximizeFull &&
+         !options()->moveResizeMaximizedWindows();
+}
+
+const Q4Win10Client::FrameMetrics &
+Q4Win10Client::frameMetrics(bool respectWindowState) const {
+  FrameMetrics &m = m_metrics[respectWindowState];
+  if (m_metricsValid[respectWindowState])
+    return m;
+
+  const bool maximized = respectWindowState && isFullyMaximized();
+  const int h =
+      frameTitleHeight(respectWindowState && isToolWindow(), m_variant.scale);
+
+  m.border = frameBorder(maximized, m_variant.scale);
+  m.titleEdgeTop = frameTitleEdgeTop(maximized);
+  m.titleEdgeSide = frameTitleEdgeSide(maximized);
+  m.titleHeight = h;
+  // Windows 10 style: Buttons are wider (rectangular)
+  m.buttonWidth = (h * 9) / 5; // 1.8 aspect ratio (Wider Win10 style)
+  // Stretch 3px up into the top border (Avoid overlapping 1px inactive
+  // border), negative margin to move button up
+  m.buttonHeight = maximized ? h : h - ButtonMarginTop;
+  m.buttonMarginTop = maximized ? 0 : ButtonMarginTop;
+
+  m_metricsValid[respectWindowState] = true;
+  return m;
+}
+
+void Q4Win10Client::invalidateFrameMetrics() {
+  m_metricsValid[0] = m_metricsValid[1] = false;
+}
+
 int Q4Win10Client::layoutMetric(LayoutMetric lm, bool respectWindowState,
                                 const KCommonDecorationButton *btn) const {
-  bool maximized = maximizeMode() == MaximizeFull &&
-                   !options()->moveResizeMaximizedWindows();
+  Q4WIN10_PROFILE_SCOPE(ProfLayoutMetric);
 
   switch (lm) {
   case LM_BorderLeft:
   case LM_BorderRight:
-  case LM_BorderBottom: {
-    if (respectWindowState && maximized) {
-      return 0;
-    } else {
-      return Handler()->borderSize();
-    }
-  }
+  case LM_BorderBottom:
+    return frameMetrics(respectWindowState).border;
 
-  case LM_TitleEdgeTop: {
-    if (respectWindowState && maximized) {
-      return 0;
-    } else {
-      return 4;
-    }
-  }
+  case LM_TitleEdgeTop:
+    return frameMetrics(respectWindowState).titleEdgeTop;
 
-  case LM_TitleEdgeBottom: {
-    return 2;
-  }
+  case LM_TitleEdgeBottom:
+    return FrameTitleEdgeBottom;
 
   case LM_TitleEdgeLeft:
-  case LM_TitleEdgeRight: {
-    if (respectWindowState && maximized) {
-      return 0;
-    } else {
-      return 1; // Minimal margin to shift menu icon left
-    }
-  }
+  case LM_TitleEdgeRight:
+    return frameMetrics(respectWindowState).titleEdgeSide;
 
   case LM_TitleBorderLeft:
   case LM_TitleBorderRight:
     return 5;
 
-  case LM_ButtonWidth: {
-    // Windows 10 style: Buttons are wider (rectangular)
-    int h = (respectWindowState && isToolWindow())
-                ? Handler()->titleHeightTool()
-                : Handler()->titleHeight();
-    return (h * 9) / 5; // 1.8 aspect ratio (Wider Win10 style)
-  }
+  case LM_ButtonWidth:
+    return frameMetrics(respectWindowState).buttonWidth;
 
-  case LM_ButtonHeight: {
-    int h = (respectWindowState && isToolWindow())
-                ? Handler()->titleHeightTool()
-                : Handler()->titleHeight();
+  case LM_ButtonHeight:
+    return frameMetrics(respectWindowState).buttonHeight;
 
-    if (respectWindowState && maximized) {
-      return h;
-    } else {
-      // Stretch 3px up into the top border (Avoid overlapping 1px inactive
-      // border)
-      return h + 3;
-    }
-  }
-
-  case LM_TitleHeight: {
-    if (respectWindowState && isToolWindow()) {
-      return Handler()->titleHeightTool();
-    } else {
-      return Handler()->titleHeight();
-    }
-  }
+  case LM_TitleHeight:
+    return frameMetrics(respectWindowState).titleHeight;
 
   case LM_ButtonSpacing:
     return 1;
 
   case LM_ButtonMarginTop:
-    if (respectWindowState && maximized) {
-      return 0;
-    } else {
-      // Negative margin to move button up
-      // -3 to avoid overlapping the 1px top inactive border
-      return -3;
-    }
+    return frameMetrics(respectWindowState).buttonMarginTop;
 
   case LM_ExplicitButtonSpacer:
     return 3;
@@ -220,12 +239,23 @@ KCommonDecorationButton *Q4Win10Client::createButton(ButtonType type) {
 }
 
 void Q4Win10Client::init() {
-  s_titleFont =
-      isToolWindow() ? Handler()->titleFontTool() : Handler()->titleFont();
+  Recorder::record(RecCreate, windowId());
+  Recorder::recordCaption(windowId(), caption());
+  updateVariant();
 
   clearCaptionPixmaps();
 
+  Handler()->menuBars()->addClient(windowId(), this);
+  // read when the menu button first draws the icon
+  m_classRequest = IconCache::requestClass(windowId());
+  m_iconRequest = Handler()->iconCache()->requestIcon(windowId());
+
   KCommonDecoration::init();
+
+  // the widget may live on another screen or visual, the scale and so the
+  // layout stay the same
+  if (updateVariant())
+    m_dirty |= DirtyCaption;
 }
 
 TQRegion Q4Win10Client::cornerShape(WindowCorner corner) {
@@ -234,17 +264,11 @@ TQRegion Q4Win10Client::cornerShape(WindowCorner corner) {
 }
 
 void Q4Win10Client::borders(int &left, int &right, int &top, int &bottom) const {
-  bool maximized = maximizeMode() == MaximizeFull &&
-                   !options()->moveResizeMaximizedWindows();
+  const FrameMetrics &m = frameMetrics(true);
+  bool maximized = isFullyMaximized();
 
-  if (maximized) {
-    left = right = bottom = 0;
-  } else {
-    left = right = bottom = Handler()->borderSize();
-  }
-
-  top = layoutMetric(LM_TitleHeight) + layoutMetric(LM_TitleEdgeTop) +
-        layoutMetric(LM_TitleEdgeBottom);
+  left = right = bottom = m.border;
+  top = m.titleHeight + m.titleEdgeTop + FrameTitleEdgeBottom;
 
   // Debug: force 4 if handler failed
   if (left < 4 && !maximized) {
@@ -252,34 +276,51 @@ void Q4Win10Client::borders(int &left, int &right, int &top, int &bottom) const
   }
 }
 
-void Q4Win10Client::paintEvent(TQPaintEvent *e) {
-  TQRegion region = e->region();
-
+namespace {
+
+// Everything the frame painter needs, gathered once per paint.
+struct PaintContext {
+  TQWidget *widget;
+  TQPaintDevice *device; // the widget or the title buffer
+  TQRect rect;           // of the whole frame
+  TQRegion region;
+  TileVariant variant;
+  int buttonsLeftWidth;
+  int buttonsRightWidth;
+  int menuBarHeight;
+  TQRect captionRect;
+  const TQPixmap *caption;
+};
+
+} // namespace
+
+// One instantiation per window state: the geometry constants fold and the
+// state branches disappear.
+template <bool ToolWindow, bool Maximized, bool Active>
+static void paintFrame(const PaintContext &c) {
   Q4Win10Handler *handler = Handler();
+  const bool active = Active;
+  const bool toolWindow = ToolWindow;
+  const TQRegion &region = c.region;
 
-  if (oldCaption != caption())
-    clearCaptionPixmaps();
-
-  bool active = isActive();
-  bool toolWindow = isToolWindow();
-
-  TQPainter painter(widget());
+  TQPainter painter(c.device);
 
   // often needed coordinates
-  TQRect r = widget()->rect();
+  TQRect r = c.rect;
 
   int r_w = r.width();
   //     int r_h = r.height();
   int r_x, r_y, r_x2, r_y2;
   r.coords(&r_x, &r_y, &r_x2, &r_y2);
-  const int borderLeft = layoutMetric(LM_BorderLeft);
-  const int borderRight = layoutMetric(LM_BorderRight);
-  const int borderBottom = layoutMetric(LM_BorderBottom);
-  const int titleHeight = layoutMetric(LM_TitleHeight);
-  const int titleEdgeTop = layoutMetric(LM_TitleEdgeTop);
-  const int titleEdgeBottom = layoutMetric(LM_TitleEdgeBottom);
-  const int titleEdgeLeft = layoutMetric(LM_TitleEdgeLeft);
-  const int titleEdgeRight = layoutMetric(LM_TitleEdgeRight);
+  // folded per variant
+  const int borderLeft = frameBorder(Maximized, c.variant.scale);
+  const int borderRight = borderLeft;
+  const int borderBottom = borderLeft;
+  const int titleHeight = frameTitleHeight(ToolWindow, c.variant.scale);
+  const int titleEdgeTop = frameTitleEdgeTop(Maximized);
+  const int titleEdgeBottom = FrameTitleEdgeBottom;
+  const int titleEdgeLeft = frameTitleEdgeSide(Maximized);
+  const int titleEdgeRight = titleEdgeLeft;
 
   const int borderBottomTop = r_y2 - borderBottom + 1;
   const int borderLeftRight = r_x + borderLeft - 1;
@@ -290,9 +331,9 @@ void Q4Win10Client::paintEvent(TQPaintEvent *e) {
   const int sideHeight = borderBottomTop - titleEdgeBottomBottom - 1;
 
   TQRect Rtitle =
-      TQRect(r_x + titleEdgeLeft + buttonsLeftWidth(), r_y + titleEdgeTop,
-             r_x2 - titleEdgeRight - buttonsRightWidth() -
-                 (r_x + titleEdgeLeft + buttonsLeftWidth()),
+      TQRect(r_x + titleEdgeLeft + c.buttonsLeftWidth, r_y + titleEdgeTop,
+             r_x2 - titleEdgeRight - c.buttonsRightWidth -
+                 (r_x + titleEdgeLeft + c.buttonsLeftWidth),
              titleEdgeBottomBottom - (r_y + titleEdgeTop));
 
   TQRect tempRect;
@@ -301,8 +342,8 @@ void Q4Win10Client::paintEvent(TQPaintEvent *e) {
   if (titleEdgeTop > 0) {
     tempRect.setRect(r_x + 2, r_y, r_w - 2 * 2, titleEdgeTop);
     if (tempRect.isValid() && region.contains(tempRect)) {
-      painter.drawTiledPixmap(
-          tempRect, handler->pixmap(TitleBarTileTop, active, toolWindow));
+      handler->paintTile(painter, tempRect, TitleBarTileTop, active,
+                         toolWindow, c.variant);
     }
   }
 
@@ -313,8 +354,8 @@ void Q4Win10Client::paintEvent(TQPaintEvent *e) {
     tempRect.setRect(r_x, r_y, borderLeft,
                      titleEdgeTop + titleHeight + titleEdgeBottom);
     if (tempRect.isValid() && region.contains(tempRect)) {
-      painter.drawTiledPixmap(
-          tempRect, handler->pixmap(TitleBarLeft, active, toolWindow));
+      handler->paintTile(painter, tempRect, TitleBarLeft, active,
+                         toolWindow, c.variant);
       titleMarginLeft = borderLeft;
     }
   }
@@ -324,57 +365,57 @@ void Q4Win10Client::paintEvent(TQPaintEvent *e) {
     tempRect.setRect(borderRightLeft, r_y, borderRight,
                      titleEdgeTop + titleHeight + titleEdgeBottom);
     if (tempRect.isValid() && region.contains(tempRect)) {
-      painter.drawTiledPixmap(
-          tempRect, handler->pixmap(TitleBarRight, active, toolWindow));
+      handler->paintTile(painter, tempRect, TitleBarRight, active,
+                         toolWindow, c.variant);
       titleMarginRight = borderRight;
     }
   }
 
   // titleSpacer
-  const TQPixmap &caption = captionPixmap();
   if (Rtitle.width() > 0) {
-    m_captionRect = captionRect(); // also update m_captionRect!
-    if (m_captionRect.isValid() && region.contains(m_captionRect)) {
-      painter.drawTiledPixmap(m_captionRect, caption);
+    const TQRect &captionRect = c.captionRect;
+    if (captionRect.isValid() && region.contains(captionRect)) {
+      painter.drawTiledPixmap(captionRect, *c.caption);
     }
 
     // left to the title
-    tempRect.setRect(r_x + titleMarginLeft, m_captionRect.top(),
-                     m_captionRect.left() - (r_x + titleMarginLeft),
-                     m_captionRect.height());
+    tempRect.setRect(r_x + titleMarginLeft, captionRect.top(),
+                     captionRect.left() - (r_x + titleMarginLeft),
+                     captionRect.height());
     if (tempRect.isValid() && region.contains(tempRect)) {
-      painter.drawTiledPixmap(
-          tempRect, handler->pixmap(TitleBarTile, active, toolWindow));
+      handler->paintTile(painter, tempRect, TitleBarTile, active,
+                         toolWindow, c.variant);
     }
 
     // right to the title
-    tempRect.setRect(m_captionRect.right() + 1, m_captionRect.top(),
-                     (r_x2 - titleMarginRight) - m_captionRect.right(),
-                     m_captionRect.height());
+    tempRect.setRect(captionRect.right() + 1, captionRect.top(),
+                     (r_x2 - titleMarginRight) - captionRect.right(),
+                     captionRect.height());
     if (tempRect.isValid() && region.contains(tempRect)) {
-      painter.drawTiledPixmap(
-          tempRect, handler->pixmap(TitleBarTile, active, toolWindow));
+      handler->paintTile(painter, tempRect, TitleBarTile, active,
+                         toolWindow, c.variant);
     }
   }
 
   // leftSpacer
   // leftSpacer
   if (borderLeft > 0 && sideHeight > 0) {
-    int mbHeight = getMenuBarHeight(windowId());
+    int mbHeight = c.menuBarHeight;
     
     // Split Border Logic
     if (mbHeight > 0 && mbHeight < sideHeight) {
         // TOP Section (Menu Bar Level) - Paint with Base Color (White)
         TQRect menuRect;
         // Adjusted height: mbHeight - 2 to match visual menu bar bottom
-        menuRect.setCoords(r_x, titleEdgeBottomBottom + 1, borderLeftRight, 
-                           titleEdgeBottomBottom + mbHeight - 2);
+        menuRect.setCoords(r_x, titleEdgeBottomBottom + 1, borderLeftRight,
+                           titleEdgeBottomBottom + mbHeight -
+                               MenuBarBorderOffset);
         if (menuRect.isValid() && region.contains(menuRect)) {
-            painter.fillRect(menuRect, widget()->colorGroup().base());
+            painter.fillRect(menuRect, c.widget->colorGroup().base());
             // Add a 1px line on the left edge if needed for contrast? 
             // The style usually puts a 1px border. Let's replicate BorderLeftTile logic for the outer edge.
             if (!active) {
-                 painter.setPen(Handler()->darkMode() ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
+                 painter.setPen(handler->edgeColor());
                  painter.drawPoint(menuRect.left(), menuRect.top());
                  painter.drawLine(menuRect.left(), menuRect.top(), menuRect.left(), menuRect.bottom());
             }
@@ -382,13 +423,15 @@ void Q4Win10Client::paintEvent(TQPaintEvent *e) {
 
         // BOTTOM Section (Rest of Window) - Paint with Standard Border Tile
         // Adjusted start Y: mbHeight - 2 + 1 = mbHeight - 1
-        tempRect.setCoords(r_x, titleEdgeBottomBottom + mbHeight - 1, borderLeftRight,
-                           borderBottomTop - 1);
+        tempRect.setCoords(r_x,
+                           titleEdgeBottomBottom + mbHeight -
+                               MenuBarBorderOffset + 1,
+                           borderLeftRight, borderBottomTop - 1);
         if (tempRect.isValid() && region.contains(tempRect)) {
            // We need to offset the tile drawing so it aligns? 
            // drawTiledPixmap origin is default top-left of rect.
-           painter.drawTiledPixmap(
-              tempRect, handler->pixmap(BorderLeftTile, active, toolWindow));
+           handler->paintTile(painter, tempRect, BorderLeftTile, active,
+                              toolWindow, c.variant);
         }
 
     } else {
@@ -396,8 +439,8 @@ void Q4Win10Client::paintEvent(TQPaintEvent *e) {
         tempRect.setCoords(r_x, titleEdgeBottomBottom + 1, borderLeftRight,
                            borderBottomTop - 1);
         if (tempRect.isValid() && region.contains(tempRect)) {
-            painter.drawTiledPixmap(
-                tempRect, handler->pixmap(BorderLeftTile, active, toolWindow));
+            handler->paintTile(painter, tempRect, BorderLeftTile, active,
+                               toolWindow, c.variant);
         }
     }
   }
@@ -405,31 +448,34 @@ void Q4Win10Client::paintEvent(TQPaintEvent *e) {
   // rightSpacer
   // rightSpacer
   if (borderRight > 0 && sideHeight > 0) {
-    int mbHeight = getMenuBarHeight(windowId());
+    int mbHeight = c.menuBarHeight;
     
     // Split Border Logic
     if (mbHeight > 0 && mbHeight < sideHeight) {
         // TOP Section (Menu Bar Level) - Paint with Base Color (White)
         TQRect menuRect;
         // Adjusted height: mbHeight - 2
-        menuRect.setCoords(borderRightLeft, titleEdgeBottomBottom + 1, r_x2, 
-                           titleEdgeBottomBottom + mbHeight - 2);
+        menuRect.setCoords(borderRightLeft, titleEdgeBottomBottom + 1, r_x2,
+                           titleEdgeBottomBottom + mbHeight -
+                               MenuBarBorderOffset);
         if (menuRect.isValid() && region.contains(menuRect)) {
-            painter.fillRect(menuRect, widget()->colorGroup().base());
+            painter.fillRect(menuRect, c.widget->colorGroup().base());
             // Outer edge logic for inactive window
             if (!active) {
-                 painter.setPen(Handler()->darkMode() ? TQColor(90, 90, 90) : TQColor(170, 170, 170));
+                 painter.setPen(handler->edgeColor());
                  painter.drawLine(menuRect.right(), menuRect.top(), menuRect.right(), menuRect.bottom());
             }
         }
 
         // BOTTOM Section (Rest of Window)
         // Adjusted start Y: mbHeight - 1
-        tempRect.setCoords(borderRightLeft, titleEdgeBottomBottom + mbHeight - 1, r_x2,
-                           borderBottomTop - 1);
+        tempRect.setCoords(borderRightLeft,
+                           titleEdgeBottomBottom + mbHeight -
+                               MenuBarBorderOffset + 1,
+                           r_x2, borderBottomTop - 1);
         if (tempRect.isValid() && region.contains(tempRect)) {
-            painter.drawTiledPixmap(
-                tempRect, handler->pixmap(BorderRightTile, active, toolWindow));
+            handler->paintTile(painter, tempRect, BorderRightTile, active,
+                               toolWindow, c.variant);
         }
 
     } else {
@@ -437,8 +483,8 @@ void Q4Win10Client::paintEvent(TQPaintEvent *e) {
         tempRect.setCoords(borderRightLeft, titleEdgeBottomBottom + 1, r_x2,
                            borderBottomTop - 1);
         if (tempRect.isValid() && region.contains(tempRect)) {
-            painter.drawTiledPixmap(
-                tempRect, handler->pixmap(BorderRightTile, active, toolWindow));
+            handler->paintTile(painter, tempRect, BorderRightTile, active,
+                               toolWindow, c.variant);
         }
     }
   }
@@ -450,27 +496,126 @@ void Q4Win10Client::paintEvent(TQPaintEvent *e) {
 
     tempRect.setRect(r_x, borderBottomTop, borderLeft, borderBottom);
     if (tempRect.isValid() && region.contains(tempRect)) {
-      painter.drawTiledPixmap(
-          tempRect, handler->pixmap(BorderBottomLeft, active, toolWindow));
+      handler->paintTile(painter, tempRect, BorderBottomLeft, active,
+                         toolWindow, c.variant);
       l = tempRect.right() + 1;
     }
 
     tempRect.setRect(borderRightLeft, borderBottomTop, borderLeft,
                      borderBottom);
     if (tempRect.isValid() && region.contains(tempRect)) {
-      painter.drawTiledPixmap(
-          tempRect, handler->pixmap(BorderBottomRight, active, toolWindow));
+      handler->paintTile(painter, tempRect, BorderBottomRight, active,
+                         toolWindow, c.variant);
       r = tempRect.left() - 1;
     }
 
     tempRect.setCoords(l, borderBottomTop, r, r_y2);
     if (tempRect.isValid() && region.contains(tempRect)) {
-      painter.drawTiledPixmap(
-          tempRect, handler->pixmap(BorderBottomTile, active, toolWindow));
+      handler->paintTile(painter, tempRect, BorderBottomTile, active,
+                         toolWindow, c.variant);
     }
   }
 }
 
+
+static void paintFrame(const PaintContext &c, int variant) {
+  switch (variant) {
+  case 0: paintFrame<false, false, false>(c); break;
+  case 1: paintFrame<false, false, true>(c); break;
+  case 2: paintFrame<false, true, false>(c); break;
+  case 3: paintFrame<false, true, true>(c); break;
+  case 4: paintFrame<true, false, false>(c); break;
+  case 5: paintFrame<true, false, true>(c); break;
+  case 6: paintFrame<true, true, false>(c); break;
+  default: paintFrame<true, true, true>(c); break;
+  }
+}
+
+// quiet time after the last paint before the other state is prerendered
+static const int PrerenderDelay = 200; // ms
+
+void Q4Win10Client::paintEvent(TQPaintEvent *e) {
+  Q4WIN10_PROFILE_SCOPE(ProfPaintEvent);
+  // everything is dirty until the first paint
+  Q4WIN10_REQUEST_SCOPE(m_dirty == DirtyAll ? OpFirstPaint : OpRepaint);
+  TraceScope trace("paint", windowId(), e->rect().width(), e->rect().height());
+  if (Recorder::enabled()) {
+    const TQMemArray<TQRect> rects = e->region().rects();
+    for (uint i = 0; i < rects.size(); ++i)
+      Recorder::record(RecExpose, windowId(), rects[i].x(), rects[i].y(),
+                       rects[i].width(), rects[i].height());
+  }
+  Q4WIN10_PROBE5(paint_start, windowId(), e->rect().x(), e->rect().y(),
+                 e->rect().width(), e->rect().height());
+
+  // only do the work the recorded changes require. A focus change keeps
+  // the title strips when both states are prerendered.
+  const unsigned int keep = prerenderedFrames() ? DirtyMenuBar | DirtyActive
+                                                : DirtyMenuBar;
+  if (m_dirty & ~keep)
+    invalidateTitleBuffers();
+  else if ((m_dirty & DirtyActive) && m_titleBufferValid[isActive()])
+    Handler()->frameSwapped();
+  if (m_dirty & (DirtyCaption | DirtyPalette))
+    clearCaptionPixmaps();
+  if (m_dirty & DirtyMenuBar) {
+    const int mbHeight = Handler()->menuBars()->height(windowId());
+    if (mbHeight != m_menuBarHeight)
+      Recorder::record(RecMenuBar, windowId(), mbHeight);
+    m_menuBarHeight = mbHeight;
+  }
+  m_dirty = 0;
+
+  const TQRect rect = captionRect();
+  if (rect != m_captionRect)
+    invalidateTitleBuffers();
+  m_captionRect = rect; // also update m_captionRect!
+
+  // the title strip is composed offscreen if enabled or cheap enough, redrawn
+  // only after a change and copied to the window with a single request
+  const TQRect strip(0, 0, widget()->width(),
+                     layoutMetric(LM_TitleEdgeTop) +
+                         layoutMetric(LM_TitleHeight) +
+                         layoutMetric(LM_TitleEdgeBottom));
+  updateTitleBuffers(strip.size());
+
+  PaintContext c;
+  c.widget = widget();
+  c.device = widget();
+  c.rect = widget()->rect();
+  c.region = e->region();
+  c.variant = m_variant;
+  c.buttonsLeftWidth = buttonsLeftWidth();
+  c.buttonsRightWidth = buttonsRightWidth();
+  c.menuBarHeight = m_menuBarHeight;
+  c.caption = &captionPixmap();
+  c.captionRect = m_captionRect;
+
+  if (m_titleBuffer[0]) {
+    const int slot = m_titleBuffer[1] ? isActive() : 0;
+    if (!m_titleBufferValid[slot])
+      renderTitleBuffer(slot, isActive());
+
+    const TQRect exposed = c.region.intersect(TQRegion(strip)).boundingRect();
+    if (exposed.isValid())
+      bitBlt(widget(), exposed.x(), exposed.y(), m_titleBuffer[slot],
+             exposed.x(), exposed.y(), exposed.width(), exposed.height());
+
+    // side and bottom borders are plain fills, draw them directly
+    c.region = c.region.subtract(TQRegion(strip));
+
+    // render the other state once things have settled. Every step of an
+    // interactive resize paints, so this waits for the end of the resize.
+    if ((m_titleBuffer[1] && !m_titleBufferValid[!slot]) ||
+        oversizedTitleBuffers())
+      m_prerenderTimer->start(PrerenderDelay, true);
+  }
+  if (!c.region.isEmpty())
+    paintFrame(c, frameVariant(isActive()));
+
+  Q4WIN10_PROBE1(paint_done, windowId());
+}
+
 TQRect Q4Win10Client::captionRect() const {
   const TQPixmap &caption = captionPixmap();
   TQRect r = widget()->rect();
@@ -511,8 +656,145 @@ TQRect Q4Win10Client::captionRect() const {
 }
 
 void Q4Win10Client::updateCaption() {
+  Recorder::recordCaption(windowId(), caption());
+
+  // keep showing the old caption until the handler gets to render the new one
+  if (oldCaption != caption() && m_captionPixmaps[isActive()]) {
+    if (m_captionThrottle->isActive()) {
+      // the held back title is never shown, the latest one is at expiry
+      Handler()->captionDropped();
+      return;
+    }
+
+    const int interval =
+        Handler()->captionInterval(!isActive() || !widget()->isVisible());
+    const int wait =
+        m_lastCaption.isValid() ? interval - m_lastCaption.elapsed() : 0;
+    if (wait > 0)
+      m_captionThrottle->start(wait, true);
+    else
+      Handler()->queueCaption(this);
+    return;
+  }
+
+  renderCaption();
+}
+
+void Q4Win10Client::flushCaption() { Handler()->queueCaption(this); }
+
+void Q4Win10Client::prerenderFrame() {
+  // give back what a shrinking resize left unused
+  if (oversizedTitleBuffers())
+    allocateTitleBuffers(m_titleBufferSize);
+
+  if (!m_titleBuffer[1])
+    return;
+  for (int active = 0; active < 2; ++active)
+    if (!m_titleBufferValid[active])
+      renderTitleBuffer(active, active);
+}
+
+int Q4Win10Client::frameVariant(bool active) const {
+  return (isToolWindow() ? 4 : 0) | (isFullyMaximized() ? 2 : 0) |
+         (active ? 1 : 0);
+}
+
+void Q4Win10Client::updateTitleBuffers(const TQSize &size) {
+  if (size == m_titleBufferSize)
+    return;
+
+  // A resize step within the allocation keeps the buffers, the strip is
+  // rendered into their top left corner. Growing allocates half again as
+  // much, so a drag reallocates a few times instead of at every step.
+  if (size.width() <= m_titleBufferCapacity.width() &&
+      size.height() <= m_titleBufferCapacity.height()) {
+    m_titleBufferSize = size;
+    invalidateTitleBuffers();
+    return;
+  }
+
+  TQSize capacity = size;
+  if (m_titleBufferCapacity.isValid()) {
+    const int screen =
+        TQApplication::desktop()->screenNumber(geometry().center());
+    const int screenWidth =
+        TQApplication::desktop()->screenGeometry(screen).width();
+    capacity.setWidth(TQMAX(
+        size.width(),
+        TQMIN(m_titleBufferCapacity.width() * 3 / 2, screenWidth)));
+  }
+  allocateTitleBuffers(capacity);
+  m_titleBufferSize = size;
+}
+
+void Q4Win10Client::allocateTitleBuffers(const TQSize &capacity) {
+  releaseTitleBuffers();
+  m_titleBufferSize = m_titleBufferCapacity = capacity;
+  if (capacity.isEmpty())
+    return;
+
+  // both states while the budget allows, a focus change then only copies.
+  // The estimate (32 bpp) also covers the button faces, which lie inside
+  // the strip.
+  const int bytes = 2 * capacity.width() * capacity.height() * 4;
+  int buffers = Handler()->bufferedTitleBar() ? 1 : 0;
+  if (Handler()->reserveFrameCache(bytes)) {
+    m_frameCacheBytes = bytes;
+    buffers = 2;
+  }
+
+  for (int i = 0; i < buffers; ++i)
+    m_titleBuffer[i] = Handler()->createPixmap(
+        capacity.width(), capacity.height(), m_variant);
+}
+
+bool Q4Win10Client::oversizedTitleBuffers() const {
+  return m_titleBuffer[0] &&
+         m_titleBufferCapacity.width() > 2 * m_titleBufferSize.width();
+}
+
+void Q4Win10Client::renderTitleBuffer(int slot, bool active) {
+  TraceScope trace("renderTitleBuffer", windowId(), m_titleBufferSize.width(),
+                   m_titleBufferSize.height());
+
+  PaintContext c;
+  c.widget = widget();
+  c.device = m_titleBuffer[slot];
+  c.rect = widget()->rect();
+  c.region = TQRegion(TQRect(TQPoint(0, 0), m_titleBufferSize));
+  c.variant = m_variant;
+  c.buttonsLeftWidth = buttonsLeftWidth();
+  c.buttonsRightWidth = buttonsRightWidth();
+  c.menuBarHeight = m_menuBarHeight;
+  c.caption = &captionPixmap(active);
+  c.captionRect = m_captionRect;
+  paintFrame(c, frameVariant(active));
+
+  m_titleBufferValid[slot] = true;
+}
+
+void Q4Win10Client::invalidateTitleBuffers() {
+  m_titleBufferValid[0] = m_titleBufferValid[1] = false;
+}
+
+void Q4Win10Client::releaseTitleBuffers() {
+  for (int i = 0; i < 2; ++i) {
+    delete m_titleBuffer[i];
+    m_titleBuffer[i] = 0;
+  }
+  invalidateTitleBuffers();
+  m_titleBufferSize = m_titleBufferCapacity = TQSize();
+
+  Handler()->releaseFrameCache(m_frameCacheBytes);
+  m_frameCacheBytes = 0;
+}
+
+void Q4Win10Client::renderCaption() {
+  Q4WIN10_REQUEST_SCOPE(OpCaptionChange);
   TQRect oldCaptionRect = m_captionRect;
+  m_lastCaption.start();
 
+  // the new caption rect depends on the new pixmap, so drop it right away
   if (oldCaption != caption())
     clearCaptionPixmaps();
 
@@ -525,41 +807,206 @@ void Q4Win10Client::updateCaption() {
 }
 
 void Q4Win10Client::reset(unsigned long changed) {
-  // Always reload config on reset to pick up Dark Mode changes
-  Handler()->readConfig();
+  // The handler has already reloaded the config (e.g. Dark Mode) before
+  // resetting the decorations.
+  Recorder::record(RecReset, windowId(), changed);
+  // title heights and the maximized window options may have changed
+  invalidateFrameMetrics();
+  invalidateMenuBarHeight();
+  // BufferedTitleBar or FrameCacheSize may have changed
+  releaseTitleBuffers();
+  // the handler has new title metrics
+  m_measuredCaption = TQString();
 
   if (changed & SettingColors) {
     // repaint the whole thing
-    clearCaptionPixmaps();
+    m_dirty |= DirtyPalette;
     widget()->update();
     updateButtons();
   } else if (changed & SettingFont) {
     // font has changed -- update title height and font
-    s_titleFont =
-        isToolWindow() ? Handler()->titleFontTool() : Handler()->titleFont();
-
+    m_dirty |= DirtyCaption | DirtyGeometry;
     updateLayout();
 
     // then repaint
-    clearCaptionPixmaps();
     widget()->update();
   }
 
   KCommonDecoration::reset(changed);
 }
 
+void Q4Win10Client::resize(const TQSize &s) {
+  Recorder::record(RecGeometry, windowId(), s.width(), s.height());
+  m_dirty |= DirtyGeometry;
+
+  // A window sent to another screen usually gets resized on the way. Switch
+  // to the tile set of the new screen; twin picks up the new borders on its
+  // next geometry update.
+  if (updateVariant()) {
+    m_measuredCaption = TQString();
+    m_dirty |= DirtyCaption;
+    updateLayout();
+    resetButtons();
+  }
+
+  KCommonDecoration::resize(s);
+}
+
+void Q4Win10Client::setMenuBarHeight(int mbHeight) {
+  // recorded even when unchanged, tests/menubartest.cpp counts the pushes
+  Recorder::record(RecMenuBar, windowId(), mbHeight);
+  m_dirty &= ~DirtyMenuBar;
+  if (mbHeight == m_menuBarHeight)
+    return;
+  m_menuBarHeight = mbHeight;
+  updateSideBorders();
+}
+
+void Q4Win10Client::menuBarHeightChanged() {
+  // the new value is read at the paint of the side borders
+  invalidateMenuBarHeight();
+  updateSideBorders();
+}
+
+void Q4Win10Client::updateSideBorders() {
+  // only the side border strips below the titlebar show the menubar level
+  const int top = layoutMetric(LM_TitleEdgeTop) + layoutMetric(LM_TitleHeight) +
+                  layoutMetric(LM_TitleEdgeBottom);
+  const int h = widget()->height() - top - layoutMetric(LM_BorderBottom);
+  const int borderLeft = layoutMetric(LM_BorderLeft);
+  const int borderRight = layoutMetric(LM_BorderRight);
+  if (h <= 0)
+    return;
+
+  if (borderLeft > 0)
+    widget()->update(0, top, borderLeft, h);
+  if (borderRight > 0)
+    widget()->update(widget()->width() - borderRight, top, borderRight, h);
+}
+
+void Q4Win10Client::invalidateMenuBarHeight() {
+  // the reply is collected at the next paint
+  m_dirty |= DirtyMenuBar;
+  Handler()->menuBars()->requestHeight(windowId());
+}
+
+void Q4Win10Client::activeChange() {
+  Q4WIN10_REQUEST_SCOPE(OpFocusChange);
+  // caption pixmaps are cached per state. The menubar height follows
+  // PropertyNotify and the table, see MenuBarTable.
+  m_dirty |= DirtyActive;
+  Recorder::record(RecActive, windowId(), isActive());
+  KCommonDecoration::activeChange();
+}
+
+void Q4Win10Client::iconChange() {
+  m_dirty |= DirtyIcon;
+  // a new icon hashes to a new entry, read with the next draw
+  if (m_iconRequest)
+    IconCache::discard(m_iconRequest);
+  m_iconRequest = Handler()->iconCache()->requestIcon(windowId());
+  KCommonDecoration::iconChange();
+}
+
+TQCString Q4Win10Client::iconKey() {
+  if (m_classRequest) {
+    m_iconClass = IconCache::readClass(m_classRequest);
+    m_classRequest = 0;
+  }
+  if (m_iconRequest) {
+    m_iconHash = IconCache::readIcon(m_iconRequest);
+    m_iconRequest = 0;
+  }
+  if (m_iconClass.isEmpty() || m_iconHash.isEmpty())
+    return TQCString();
+  return m_iconClass + "-" + m_iconHash;
+}
+
+void Q4Win10Client::maximizeChange() {
+  Q4WIN10_REQUEST_SCOPE(OpMaximize);
+  m_dirty |= DirtyGeometry | DirtyButtonState;
+  Recorder::record(RecMaximize, windowId(), maximizeMode());
+  invalidateFrameMetrics();
+  KCommonDecoration::maximizeChange();
+}
+
+bool Q4Win10Client::updateVariant() {
+  TileVariant v;
+  int screen = TQApplication::desktop()->screenNumber(geometry().center());
+  v.scale = Handler()->scaleFactor(screen);
+  // before init() there is no widget yet, assume the default screen
+  if (widget())
+    v.x11Screen = widget()->x11Screen();
+  if (v == m_variant)
+    return false;
+
+  m_variant = v;
+  invalidateFrameMetrics();
+  // the title buffers live on the old screen
+  releaseTitleBuffers();
+  return true;
+}
+
+void Q4Win10Client::scheduleHoverSync() {
+  if (m_hoverSyncPending)
+    return;
+
+  // buttons are reset one by one (e.g. on maximize), collect them all. The
+  // pointer query is sent now and its reply read when the sync runs.
+  m_hoverSyncPending = true;
+  m_pointerRequest =
+      xcb_query_pointer(XGetXCBConnection(tqt_xdisplay()),
+                        RootWindow(tqt_xdisplay(), widget()->x11Screen()))
+          .sequence;
+  TQTimer::singleShot(0, this, TQT_SLOT(syncButtonHover()));
+}
+
+void Q4Win10Client::syncButtonHover() {
+  m_hoverSyncPending = false;
+
+  // one QueryPointer round trip for the whole decoration
+  TraceScope trace("queryPointer", windowId());
+  xcb_query_pointer_cookie_t cookie;
+  cookie.sequence = m_pointerRequest;
+  xcb_query_pointer_reply_t *reply =
+      xcb_query_pointer_reply(XGetXCBConnection(tqt_xdisplay()), cookie, 0);
+  if (!reply)
+    return;
+  // a pointer on another screen hovers nothing here
+  TQPoint pos(-1, -1);
+  if (reply->same_screen)
+    pos = widget()->mapFromGlobal(TQPoint(reply->root_x, reply->root_y));
+  free(reply);
+
+  const TQObjectList *children = widget()->children();
+  if (!children || !widget()->isVisible())
+    return;
+
+  TQObjectListIt it(*children);
+  for (TQObject *o; (o = it.current()) != 0; ++it) {
+    if (!o->inherits("KWinQ4Win10::Q4Win10Button"))
+      continue;
+
+    Q4Win10Button *button = static_cast<Q4Win10Button *>(o);
+    if (button->isVisible())
+      button->setHover(button->geometry().contains(pos));
+  }
+}
+
 const TQPixmap &Q4Win10Client::getTitleBarTile(bool active) const {
-  return Handler()->pixmap(TitleBarTile, active, isToolWindow());
+  return Handler()->pixmap(TitleBarTile, active, isToolWindow(), m_variant);
 }
 
-const TQPixmap &Q4Win10Client::captionPixmap() const {
-  bool active = isActive();
+const TQPixmap &Q4Win10Client::captionPixmap(bool active) const {
+  Q4WIN10_PROFILE_SCOPE(ProfCaptionPixmap);
 
   if (m_captionPixmaps[active]) {
     return *m_captionPixmaps[active];
   }
 
   // not found, create new pixmap...
+  Q4WIN10_PROBE2(caption_render, windowId(), active);
+  TraceScope trace("renderCaption", windowId());
 
   const uint maxCaptionLength = 300; // truncate captions longer than this!
   TQString c(caption());
@@ -568,9 +1015,8 @@ const TQPixmap &Q4Win10Client::captionPixmap() const {
     c.append(" [...]");
   }
 
-  TQFontMetrics fm(s_titleFont);
-  int captionWidth = fm.width(c);
-  int captionHeight = fm.height();
+  int captionWidth = this->captionWidth(c);
+  int captionHeight = titleMetrics().height();
 
   const int th = layoutMetric(LM_TitleHeight, false) +
                  layoutMetric(LM_TitleEdgeBottom, false);
@@ -579,15 +1025,16 @@ const TQPixmap &Q4Win10Client::captionPixmap() const {
 
   const int thickness = 2;
 
-  TQPixmap *captionPixmap = new TQPixmap(captionWidth + 2 * thickness, th);
+  TQPixmap *captionPixmap =
+      Handler()->createPixmap(captionWidth + 2 * thickness, th, m_variant);
 
   painter.begin(captionPixmap);
-  painter.drawTiledPixmap(
-      captionPixmap->rect(),
-      Handler()->pixmap(TitleBarTile, active, isToolWindow()));
+  Handler()->paintTile(painter, captionPixmap->rect(), TitleBarTile, active,
+                       isToolWindow(), m_variant);
 
-  painter.setFont(s_titleFont);
-  TQPoint tp(1, captionHeight - 4); // Adjusted: -3 instead of -1 to center title vertically
+  painter.setFont(titleFont());
+  // Adjusted: -4 instead of -1 to center title vertically
+  TQPoint tp(1, captionHeight - CaptionBaselineOffset);
   if (Handler()->titleShadow()) {
     TQColor shadowColor;
     if (tqGray(Handler()->getColor(TitleFont, active).rgb()) < 100)
@@ -609,11 +1056,50 @@ const TQPixmap &Q4Win10Client::captionPixmap() const {
   painter.drawText(tp, c);
   painter.end();
 
+  trace.setSize(captionPixmap->width(), captionPixmap->height());
   m_captionPixmaps[active] = captionPixmap;
   return *captionPixmap;
 }
 
+const TQFont &Q4Win10Client::titleFont() const {
+  return isToolWindow() ? Handler()->titleFontTool(m_variant.scale)
+                        : Handler()->titleFont(m_variant.scale);
+}
+
+TitleMetrics &Q4Win10Client::titleMetrics() const {
+  return Handler()->titleMetrics(isToolWindow(), m_variant.scale);
+}
+
+int Q4Win10Client::captionWidth(const TQString &c) const {
+  TitleMetrics &tm = titleMetrics();
+
+  // retitles mostly change the end (counters, paths, progress)
+  const uint n = c.length();
+  const uint m = TQMIN(n, m_measuredCaption.length());
+  uint common = 0;
+  while (common < m && c.at(common) == m_measuredCaption.at(common))
+    ++common;
+
+  if (m_prefixWidths.size() < n + 1)
+    m_prefixWidths.resize(n + 1);
+  m_prefixWidths[0] = 0;
+
+  // TQt does not kern Latin text, the sum of the advances is the width
+  for (uint i = common; i < n; ++i) {
+    const int a = tm.advance(c.at(i));
+    if (a < 0) {
+      m_measuredCaption = TQString();
+      return tm.metrics().width(c);
+    }
+    m_prefixWidths[i + 1] = m_prefixWidths[i] + a;
+  }
+
+  m_measuredCaption = c;
+  return m_prefixWidths[n];
+}
+
 void Q4Win10Client::clearCaptionPixmaps() {
+  invalidateTitleBuffers();
   for (int i = 0; i < 2; ++i) {
     delete m_captionPixmaps[i];
     m_captionPixmaps[i] = 0;
@@ -24,6 +24,8 @@
 #define Q4WIN10CLIENT_H
 
 #include <kcommondecoration.h>
+#include <tqdatetime.h>
+#include <tqmemarray.h>
 
 #include "q4win10.h"
 
@@ -32,6 +34,7 @@ namespace KWinQ4Win10 {
 class Q4Win10Button;
 
 class Q4Win10Client : public KCommonDecoration {
+  TQ_OBJECT
 public:
   Q4Win10Client(KDecorationBridge *bridge, KDecorationFactory *factory);
   ~Q4Win10Client();
@@ -51,22 +54,107 @@ public:
 
   virtual void paintEvent(TQPaintEvent *e);
   virtual void updateCaption();
+  virtual void resize(const TQSize &s);
+  virtual void activeChange();
+  virtual void iconChange();
+  virtual void maximizeChange();
 
   const TQPixmap &getTitleBarTile(bool active) const;
+  int scale() const { return m_variant.scale; }
+  const TileVariant &tileVariant() const { return m_variant; }
+
+  // query the pointer once for all buttons after the current event
+  void scheduleHoverSync();
+  // pushed by the MenuBarTable, repaints the side borders only
+  void setMenuBarHeight(int mbHeight);
+  // the per-window property changed, read it at the next paint
+  void menuBarHeightChanged();
+  // called by the handler when a queued caption is due
+  void renderCaption();
+  // title strips of both activation states are kept, buttons may keep
+  // their faces too
+  bool prerenderedFrames() const { return m_frameCacheBytes > 0; }
+  // the icon cache key from WM_CLASS and _NET_WM_ICON, requested at
+  // adoption and after an icon change; empty = don't cache
+  TQCString iconKey();
+
+private slots:
+  void syncButtonHover();
+  void flushCaption();
+  void prerenderFrame();
 
 private:
+  friend class HarnessAccess; // tests/ renders captions directly
+
+  // layout metrics of the current state, recomputed only after a change
+  struct FrameMetrics {
+    int border;
+    int titleEdgeTop;
+    int titleEdgeSide;
+    int titleHeight;
+    int buttonWidth;
+    int buttonHeight;
+    int buttonMarginTop;
+  };
+  const FrameMetrics &frameMetrics(bool respectWindowState) const;
+  void invalidateFrameMetrics();
+
+  bool isFullyMaximized() const;
+  bool updateVariant();
+  void invalidateMenuBarHeight();
+  void updateSideBorders();
+
   TQRect captionRect() const;
+  const TQFont &titleFont() const;
+  TitleMetrics &titleMetrics() const;
+  int captionWidth(const TQString &c) const;
 
-  const TQPixmap &captionPixmap() const;
+  const TQPixmap &captionPixmap() const { return captionPixmap(isActive()); }
+  const TQPixmap &captionPixmap(bool active) const;
   void clearCaptionPixmaps();
 
+  int frameVariant(bool active) const;
+  void updateTitleBuffers(const TQSize &size);
+  void allocateTitleBuffers(const TQSize &capacity);
+  bool oversizedTitleBuffers() const;
+  void renderTitleBuffer(int slot, bool active);
+  void invalidateTitleBuffers();
+  void releaseTitleBuffers();
+
   mutable TQPixmap *m_captionPixmaps[2];
 
   TQRect m_captionRect;
   TQString oldCaption;
-
-  // settings...
-  TQFont s_titleFont;
+  TQTimer *m_captionThrottle; // holds back titles that come too fast
+  TQTime m_lastCaption;       // last render, for the rate limit
+
+  TileVariant m_variant; // scale and X screen the window is on
+  bool m_hoverSyncPending;
+  unsigned int m_pointerRequest; // sequence of the pending QueryPointer
+  unsigned int m_classRequest;   // of the pending WM_CLASS, 0 = read
+  unsigned int m_iconRequest;    // of the pending _NET_WM_ICON, 0 = read
+  TQCString m_iconClass;
+  TQCString m_iconHash;
+
+  unsigned int m_dirty; // DirtyFlags
+  int m_menuBarHeight;  // set by the Q4Win10 style, 0 = none
+
+  mutable FrameMetrics m_metrics[2]; // [respectWindowState]
+  mutable bool m_metricsValid[2];
+
+  // offscreen title strip, see Q4Win10Handler::bufferedTitleBar(). With a
+  // frame cache reservation there is one per activation state.
+  TQPixmap *m_titleBuffer[2];
+  bool m_titleBufferValid[2];
+  TQSize m_titleBufferSize;     // of the strip, at most the capacity
+  TQSize m_titleBufferCapacity; // of the last allocation attempt
+  int m_frameCacheBytes;        // reserved from the handler, 0 = none
+  TQTimer *m_prerenderTimer;    // the other state, when things have settled
+
+  // widths of the prefixes of the last measured caption, a retitle only
+  // measures from the first changed character on
+  mutable TQString m_measuredCaption;
+  mutable TQMemArray<int> m_prefixWidths;
 };
 
 } // namespace KWinQ4Win10
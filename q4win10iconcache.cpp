@@ -0,0 +1,382 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#include "q4win10iconcache.h"
+#include "q4win10trace.h"
+
+#include <tqimage.h>
+
+#include <X11/Xlib-xcb.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+#include <xcb/xcb.h>
+
+namespace KWinQ4Win10 {
+
+static const char IconMagic[4] = {'Q', '4', 'W', 'I'};
+static const uint32_t IconVersion = 2;
+
+// 32 bit words of _NET_WM_ICON hashed for the entry name (16 KiB per
+// window at adoption): the 16 and 32 pixel sizes and most of 48, the total
+// length covers the rest
+static const uint32_t IconHashLength = 4096;
+
+// an entry is marked used at most once a day, that is enough for trim()
+static const time_t IconTouchInterval = 24 * 60 * 60;
+
+// the ARGB32 pixels follow, in host byte order
+struct IconHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t byteOrder;    // 0x01020304
+  uint32_t sourceWidth;  // of the unscaled icon
+  uint32_t sourceHeight;
+  uint32_t width;
+  uint32_t height;
+  uint32_t alpha;
+};
+
+// '-' separates the parts of the entry name
+static TQCString fileNamePart(const char *s, size_t length) {
+  TQCString name(s, length + 1);
+  for (char *p = name.data(); *p; ++p)
+    if (!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') ||
+          (*p >= '0' && *p <= '9') || *p == '.' || *p == '_'))
+      *p = '_';
+  return name;
+}
+
+// total size of the entries in dir
+static long scanDir(const char *dir) {
+  DIR *d = opendir(dir);
+  if (!d)
+    return 0;
+
+  long total = 0;
+  struct dirent *e;
+  char path[PATH_MAX];
+  struct stat st;
+  while ((e = readdir(d))) {
+    if (fnmatch("*.argb", e->d_name, 0) != 0)
+      continue;
+    snprintf(path, sizeof(path), "%s/%s", dir, e->d_name);
+    if (stat(path, &st) == 0)
+      total += st.st_size;
+  }
+  closedir(d);
+  return total;
+}
+
+// the unscaled icon read back from the server and smooth-scaled
+static TQPixmap scale(const TQPixmap &source, int size, TQImage *scaled) {
+  // a synchronous XGetImage inside TQt, it cannot be pipelined
+  *scaled = source.convertToImage().convertDepth(32).smoothScale(size, size);
+  TQPixmap pixmap;
+  pixmap.convertFromImage(*scaled);
+  return pixmap;
+}
+
+IconCache::IconCache()
+    : m_theme("default"), m_limit(0), m_used(-1), m_hits(0), m_misses(0),
+      m_iconAtom(XCB_ATOM_NONE) {
+  // read with the first window
+  static const char name[] = "_NET_WM_ICON";
+  m_atomRequest = xcb_intern_atom(XGetXCBConnection(tqt_xdisplay()), 0,
+                                  sizeof(name) - 1, name)
+                      .sequence;
+
+  const char *xdg = getenv("XDG_CACHE_HOME");
+  if (xdg && *xdg) {
+    m_dir = xdg;
+  } else {
+    const char *home = getenv("HOME");
+    m_dir = home ? home : "";
+    m_dir += "/.cache";
+  }
+  m_dir += "/q4win10";
+}
+
+IconCache::~IconCache() {
+  if (m_atomRequest)
+    discard(m_atomRequest);
+}
+
+unsigned int IconCache::requestClass(WId window) {
+  return xcb_get_property(XGetXCBConnection(tqt_xdisplay()), 0, window,
+                          XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, 64)
+      .sequence;
+}
+
+TQCString IconCache::readClass(unsigned int request) {
+  xcb_get_property_cookie_t cookie;
+  cookie.sequence = request;
+  xcb_get_property_reply_t *reply =
+      xcb_get_property_reply(XGetXCBConnection(tqt_xdisplay()), cookie, 0);
+  if (!reply)
+    return TQCString();
+
+  // instance and class name, each NUL terminated
+  TQCString name;
+  const char *v = (const char *)xcb_get_property_value(reply);
+  const size_t length = xcb_get_property_value_length(reply);
+  const size_t instance = strnlen(v, length) + 1;
+  if (instance < length)
+    name = fileNamePart(v + instance, strnlen(v + instance, length - instance));
+  free(reply);
+  return name;
+}
+
+unsigned int IconCache::requestIcon(WId window) {
+  xcb_connection_t *c = XGetXCBConnection(tqt_xdisplay());
+  if (m_atomRequest) {
+    xcb_intern_atom_cookie_t cookie;
+    cookie.sequence = m_atomRequest;
+    xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(c, cookie, 0);
+    if (reply) {
+      m_iconAtom = reply->atom;
+      free(reply);
+    }
+    m_atomRequest = 0;
+  }
+  if (m_iconAtom == XCB_ATOM_NONE)
+    return 0;
+  return xcb_get_property(c, 0, window, m_iconAtom, XCB_ATOM_CARDINAL, 0,
+                          IconHashLength)
+      .sequence;
+}
+
+TQCString IconCache::readIcon(unsigned int request) {
+  xcb_get_property_cookie_t cookie;
+  cookie.sequence = request;
+  xcb_get_property_reply_t *reply =
+      xcb_get_property_reply(XGetXCBConnection(tqt_xdisplay()), cookie, 0);
+  if (!reply)
+    return TQCString();
+
+  // FNV-1a over the pixels read and the total length
+  TQCString hash;
+  const int length = xcb_get_property_value_length(reply);
+  if (reply->type == XCB_ATOM_CARDINAL && reply->format == 32 &&
+      length >= 8) {
+    uint32_t h = 2166136261u;
+    const unsigned char *v =
+        (const unsigned char *)xcb_get_property_value(reply);
+    for (int i = 0; i < length; ++i)
+      h = (h ^ v[i]) * 16777619u;
+    const uint32_t total = length + reply->bytes_after;
+    for (int i = 0; i < 4; ++i)
+      h = (h ^ ((total >> (8 * i)) & 0xff)) * 16777619u;
+    hash.sprintf("%08x", h);
+  }
+  free(reply);
+  return hash;
+}
+
+void IconCache::discard(unsigned int request) {
+  xcb_discard_reply(XGetXCBConnection(tqt_xdisplay()), request);
+}
+
+void IconCache::setTheme(const TQString &theme) {
+  const TQCString name = theme.utf8();
+  m_theme = fileNamePart(name.data(), name.length());
+}
+
+TQPixmap IconCache::scaledIcon(WId window, const TQCString &key,
+                               const TQPixmap &source, int size) {
+  TraceScope trace("scaledIcon", window, size, size);
+
+  TQImage scaled;
+  // windows without a class or _NET_WM_ICON share nothing
+  if (m_limit <= 0 || key.isEmpty() || source.isNull())
+    return scale(source, size, &scaled);
+
+  // everything in the name is known without waiting for the server
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/%s-%s-%dx%d-%d.argb", m_dir.data(),
+           m_theme.data(), key.data(), source.width(), source.height(),
+           size);
+  TQPixmap pixmap;
+  if (load(path, source.size(), size, pixmap)) {
+    ++m_hits;
+    return pixmap;
+  }
+
+  ++m_misses;
+  pixmap = scale(source, size, &scaled);
+  store(path, source.size(), scaled);
+  return pixmap;
+}
+
+bool IconCache::load(const char *path, const TQSize &source, int size,
+                     TQPixmap &pixmap) {
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  const size_t length = sizeof(IconHeader) + size * size * 4;
+  bool ok = false;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size == length) {
+    // private, so the pixels can be handed out without a copy
+    void *map = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      const IconHeader *h = (const IconHeader *)map;
+      if (memcmp(h->magic, IconMagic, sizeof(h->magic)) == 0 &&
+          h->version == IconVersion && h->byteOrder == 0x01020304 &&
+          h->sourceWidth == (uint32_t)source.width() &&
+          h->sourceHeight == (uint32_t)source.height() &&
+          h->width == (uint32_t)size &&
+          h->height == (uint32_t)size) {
+        TQImage image((uchar *)(h + 1), size, size, 32, 0, 0,
+                      TQImage::IgnoreEndian);
+        image.setAlphaBuffer(h->alpha);
+        ok = pixmap.convertFromImage(image);
+      }
+      munmap(map, length);
+    }
+  }
+  close(fd);
+
+  if (ok) {
+    // recently used, trim() keeps it
+    if (st.st_mtime < time(0) - IconTouchInterval)
+      utime(path, 0);
+  } else
+    unlink(path); // damaged or written by another version
+  return ok;
+}
+
+void IconCache::store(const char *path, const TQSize &source,
+                      const TQImage &image) {
+  // the directory is counted once, then the total is kept up to date
+  if (m_used < 0) {
+    // ~/.cache may not exist yet either
+    const int slash = m_dir.findRev('/');
+    if (slash > 0)
+      mkdir(m_dir.left(slash).data(), 0700);
+    if (mkdir(m_dir.data(), 0700) != 0 && errno != EEXIST)
+      return;
+    m_used = scanDir(m_dir.data());
+  }
+
+  // written aside and renamed, a second twin never sees half an entry
+  char tmp[PATH_MAX];
+  snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+  FILE *f = fopen(tmp, "wb");
+  if (!f)
+    return;
+
+  IconHeader header;
+  memcpy(header.magic, IconMagic, sizeof(header.magic));
+  header.version = IconVersion;
+  header.byteOrder = 0x01020304;
+  header.sourceWidth = source.width();
+  header.sourceHeight = source.height();
+  header.width = image.width();
+  header.height = image.height();
+  header.alpha = image.hasAlphaBuffer();
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+  for (int y = 0; ok && y < image.height(); ++y)
+    ok = fwrite(image.scanLine(y), image.width() * 4, 1, f) == 1;
+  ok = fclose(f) == 0 && ok;
+
+  // an icon set again replaces the entry
+  struct stat st;
+  const long replaced = stat(path, &st) == 0 ? st.st_size : 0;
+  if (!ok || rename(tmp, path) != 0) {
+    unlink(tmp);
+    return;
+  }
+  m_used -= replaced;
+
+  m_used += sizeof(header) + image.width() * image.height() * 4;
+  if (m_used > m_limit)
+    trim();
+}
+
+struct IconEntry {
+  time_t time;
+  long size;
+  char name[NAME_MAX + 1];
+};
+
+static int compareEntries(const void *a, const void *b) {
+  const time_t ta = ((const IconEntry *)a)->time;
+  const time_t tb = ((const IconEntry *)b)->time;
+  return ta < tb ? -1 : ta > tb;
+}
+
+void IconCache::trim() {
+  TraceScope trace("trimIconCache");
+
+  DIR *d = opendir(m_dir.data());
+  if (!d)
+    return;
+
+  IconEntry *entries = 0;
+  int count = 0, capacity = 0;
+  struct dirent *e;
+  char path[PATH_MAX];
+  struct stat st;
+  m_used = 0;
+  while ((e = readdir(d))) {
+    if (fnmatch("*.argb", e->d_name, 0) != 0)
+      continue;
+    snprintf(path, sizeof(path), "%s/%s", m_dir.data(), e->d_name);
+    if (stat(path, &st) != 0)
+      continue;
+    if (count == capacity) {
+      capacity = capacity ? 2 * capacity : 64;
+      IconEntry *grown =
+          (IconEntry *)realloc(entries, capacity * sizeof(IconEntry));
+      if (!grown)
+        break;
+      entries = grown;
+    }
+    entries[count].time = st.st_mtime;
+    entries[count].size = st.st_size;
+    strncpy(entries[count].name, e->d_name, NAME_MAX);
+    entries[count].name[NAME_MAX] = 0;
+    m_used += st.st_size;
+    ++count;
+  }
+  closedir(d);
+
+  // least recently used first, down to 3/4 so the next stores don't trim
+  qsort(entries, count, sizeof(IconEntry), compareEntries);
+  for (int i = 0; i < count && m_used > m_limit * 3 / 4; ++i) {
+    snprintf(path, sizeof(path), "%s/%s", m_dir.data(), entries[i].name);
+    if (unlink(path) == 0)
+      m_used -= entries[i].size;
+  }
+  free(entries);
+}
+
+} // namespace KWinQ4Win10
@@ -0,0 +1,91 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef Q4WIN10ICONCACHE_H
+#define Q4WIN10ICONCACHE_H
+
+#include <tqcstring.h>
+#include <tqpixmap.h>
+#include <tqstring.h>
+#include <tqwindowdefs.h>
+
+namespace KWinQ4Win10 {
+
+/**
+ * Scaled application icons kept on disk across sessions.
+ *
+ * Entries live in $XDG_CACHE_HOME/q4win10 (~/.cache/q4win10), one file per
+ * icon named <icon theme>-<WM_CLASS>-<icon hash>-<source size>-<size>.argb:
+ * a header followed by the ARGB32 pixels in host byte order. The icon hash
+ * is taken over the _NET_WM_ICON property, so a new icon of the same
+ * application gets a new entry. WM_CLASS and _NET_WM_ICON are requested
+ * when the window is adopted and the replies read at the first draw, so a
+ * hit never waits for the server nor reads the unscaled icon back. Files
+ * are memory-mapped and handed to the X server straight from the mapping.
+ * Damaged files are deleted when they fail to load, and windows without
+ * WM_CLASS or _NET_WM_ICON are not cached. Once the tracked total exceeds
+ * the limit the least recently used entries are deleted.
+ */
+class IconCache {
+public:
+  IconCache();
+  ~IconCache();
+
+  // bytes on disk, 0 = don't cache
+  void setLimit(long limit) { m_limit = limit; }
+  // the icon theme the applications take their icons from
+  void setTheme(const TQString &theme);
+
+  // WM_CLASS and _NET_WM_ICON of window: sent now, the replies read when
+  // the icon is needed. readClass() returns the class name usable in a
+  // file name, readIcon() the hash of the icon; both are empty if the
+  // window has none. requestIcon() returns 0 if nothing was sent.
+  static unsigned int requestClass(WId window);
+  static TQCString readClass(unsigned int request);
+  unsigned int requestIcon(WId window);
+  static TQCString readIcon(unsigned int request);
+  // drops the reply of a request that will not be read
+  static void discard(unsigned int request);
+
+  // the icon of window smooth-scaled to size x size. key names the entry,
+  // <WM_CLASS>-<icon hash>, empty = not cached.
+  TQPixmap scaledIcon(WId window, const TQCString &key,
+                      const TQPixmap &source, int size);
+
+  unsigned long hits() const { return m_hits; }
+  unsigned long misses() const { return m_misses; }
+
+private:
+  bool load(const char *path, const TQSize &source, int size,
+            TQPixmap &pixmap);
+  void store(const char *path, const TQSize &source, const TQImage &image);
+  void trim();
+
+  TQCString m_dir;
+  TQCString m_theme;
+  long m_limit;
+  long m_used; // bytes in m_dir, -1 = not counted yet
+  unsigned long m_hits;
+  unsigned long m_misses;
+  unsigned int m_atomRequest; // of _NET_WM_ICON, 0 = read
+  unsigned long m_iconAtom;
+};
+
+} // namespace KWinQ4Win10
+
+#endif // Q4WIN10ICONCACHE_H
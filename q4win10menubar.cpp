@@ -0,0 +1,285 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#include <tdeapplication.h>
+
+#include "q4win10client.h"
+#include "q4win10menubar.h"
+#include "q4win10profile.h"
+#include "q4win10trace.h"
+
+#include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xcb/xcb.h>
+
+namespace KWinQ4Win10 {
+
+static const long MenuBarTableVersion = 1;
+static const long MaxMenuBarEntries = 4096;
+
+static xcb_intern_atom_cookie_t internAtom(xcb_connection_t *c,
+                                           const char *name) {
+  return xcb_intern_atom(c, 0, strlen(name), name);
+}
+
+static Atom internAtomReply(xcb_connection_t *c,
+                            xcb_intern_atom_cookie_t cookie) {
+  xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(c, cookie, 0);
+  if (!reply)
+    return None;
+
+  Atom atom = reply->atom;
+  free(reply);
+  return atom;
+}
+
+MenuBarTable::MenuBarTable() : TQWidget(0, "q4win10_menubar_table"),
+      m_version(0) {
+  Display *dpy = tqt_xdisplay();
+  xcb_connection_t *c = XGetXCBConnection(dpy);
+
+  // both atoms in one round trip
+  xcb_intern_atom_cookie_t tableCookie =
+      internAtom(c, "_Q4WIN10_MENUBAR_HEIGHTS");
+  xcb_intern_atom_cookie_t windowCookie =
+      internAtom(c, "_Q4WIN10_MENUBAR_HEIGHT");
+  m_tableAtom = internAtomReply(c, tableCookie);
+  m_windowAtom = internAtomReply(c, windowCookie);
+
+  // listen for table updates without clobbering twin's own root mask
+  XWindowAttributes attr;
+  if (XGetWindowAttributes(dpy, tqt_xrootwin(), &attr))
+    XSelectInput(dpy, tqt_xrootwin(),
+                 attr.your_event_mask | PropertyChangeMask);
+
+  TDEApplication::kApplication()->installX11EventFilter(this);
+
+  readTable();
+}
+
+MenuBarTable::~MenuBarTable() {
+  TDEApplication::kApplication()->removeX11EventFilter(this);
+
+  xcb_connection_t *c = XGetXCBConnection(tqt_xdisplay());
+  TQMap<WId, unsigned int>::ConstIterator it;
+  for (it = m_pending.begin(); it != m_pending.end(); ++it)
+    xcb_discard_reply(c, it.data());
+  for (it = m_masks.begin(); it != m_masks.end(); ++it)
+    xcb_discard_reply(c, it.data());
+}
+
+void MenuBarTable::requestHeight(WId window) {
+  if (!window || m_version != 0 || m_pending.contains(window))
+    return;
+
+  xcb_get_property_cookie_t cookie =
+      xcb_get_property(XGetXCBConnection(tqt_xdisplay()), 0, window,
+                       m_windowAtom, XCB_ATOM_CARDINAL, 0, 1);
+  m_pending.insert(window, cookie.sequence);
+  Q4WIN10_PROBE1(menubar_request, window);
+}
+
+int MenuBarTable::height(WId window) {
+  if (!window)
+    return 0;
+
+  if (m_version == 0) {
+    const int h = readWindowProperty(window);
+    selectPropertyChanges(window);
+    return h;
+  }
+
+  TQMap<WId, int>::ConstIterator it = m_heights.find(window);
+  return it != m_heights.end() ? it.data() : 0;
+}
+
+void MenuBarTable::addClient(WId window, Q4Win10Client *client) {
+  m_clients.replace(window, client);
+
+  // the style may set the property at any time, see x11Event(). The event
+  // mask is merged once the attributes are in, sent ahead of the property
+  // read so they arrive with it.
+  if (window && !m_masks.contains(window))
+    m_masks.insert(window,
+                   xcb_get_window_attributes(XGetXCBConnection(tqt_xdisplay()),
+                                             window)
+                       .sequence);
+  requestHeight(window);
+}
+
+void MenuBarTable::removeClient(WId window) {
+  m_clients.remove(window);
+  discardPending(window);
+
+  TQMap<WId, unsigned int>::Iterator it = m_masks.find(window);
+  if (it != m_masks.end()) {
+    xcb_discard_reply(XGetXCBConnection(tqt_xdisplay()), it.data());
+    m_masks.remove(it);
+  }
+}
+
+void MenuBarTable::discardPending(WId window) {
+  TQMap<WId, unsigned int>::Iterator it = m_pending.find(window);
+  if (it != m_pending.end()) {
+    xcb_discard_reply(XGetXCBConnection(tqt_xdisplay()), it.data());
+    m_pending.remove(it);
+  }
+}
+
+void MenuBarTable::selectPropertyChanges(WId window) {
+  TQMap<WId, unsigned int>::Iterator it = m_masks.find(window);
+  if (it == m_masks.end())
+    return;
+
+  xcb_connection_t *c = XGetXCBConnection(tqt_xdisplay());
+  xcb_get_window_attributes_cookie_t cookie;
+  cookie.sequence = it.data();
+  m_masks.remove(it);
+
+  // no round trip of its own, the reply came in before the property's
+  xcb_get_window_attributes_reply_t *reply =
+      xcb_get_window_attributes_reply(c, cookie, 0);
+  if (!reply)
+    return;
+
+  // twin usually watches its clients' properties already; keep its mask
+  if (!(reply->your_event_mask & XCB_EVENT_MASK_PROPERTY_CHANGE)) {
+    const uint32_t mask =
+        reply->your_event_mask | XCB_EVENT_MASK_PROPERTY_CHANGE;
+    xcb_change_window_attributes(c, window, XCB_CW_EVENT_MASK, &mask);
+  }
+  free(reply);
+}
+
+bool MenuBarTable::x11Event(XEvent *e) {
+  if (e->type != PropertyNotify)
+    return false;
+
+  if (e->xproperty.window == tqt_xrootwin()) {
+    if (e->xproperty.atom == m_tableAtom)
+      readTable();
+  } else if (e->xproperty.atom == m_windowAtom && m_version == 0) {
+    // set or removed after the window was mapped; a reply still in flight
+    // may hold the old value
+    TQMap<WId, Q4Win10Client *>::ConstIterator it =
+        m_clients.find(e->xproperty.window);
+    if (it != m_clients.end()) {
+      discardPending(it.key());
+      it.data()->menuBarHeightChanged();
+    }
+  }
+
+  // twin needs to see the event as well
+  return false;
+}
+
+void MenuBarTable::readTable() {
+  TraceScope trace("menubarTable");
+  TQMap<WId, int> heights;
+  long version = 0;
+
+  Atom actualType;
+  int actualFormat;
+  unsigned long nitems;
+  unsigned long bytesAfter;
+  unsigned char *prop = 0;
+
+  if (XGetWindowProperty(tqt_xdisplay(), tqt_xrootwin(), m_tableAtom, 0,
+                         2 + 2 * MaxMenuBarEntries, False, XA_CARDINAL,
+                         &actualType, &actualFormat, &nitems, &bytesAfter,
+                         &prop) == Success) {
+    if (prop) {
+      if (actualType == XA_CARDINAL && actualFormat == 32 && nitems >= 2) {
+        const long *data = (const long *)prop;
+        // ignore tables of a newer protocol we don't understand
+        if (data[0] == MenuBarTableVersion) {
+          version = data[0];
+          unsigned long count = TQMIN((unsigned long)data[1], (nitems - 2) / 2);
+          for (unsigned long i = 0; i < count; ++i)
+            heights.replace((WId)data[2 + 2 * i], (int)data[3 + 2 * i]);
+        }
+      }
+      XFree(prop);
+    }
+  }
+
+  Q4WIN10_PROBE2(menubar_table, version, heights.count());
+
+  const bool wasPublished = m_version != 0;
+  if (!wasPublished && version == 0)
+    return;
+
+  TQMap<WId, int> old = m_heights;
+  m_heights = heights;
+  m_version = version;
+
+  // per-window requests still in flight are obsolete now
+  if (m_version != 0 && !m_pending.isEmpty()) {
+    xcb_connection_t *c = XGetXCBConnection(tqt_xdisplay());
+    TQMap<WId, unsigned int>::ConstIterator p;
+    for (p = m_pending.begin(); p != m_pending.end(); ++p)
+      xcb_discard_reply(c, p.data());
+    m_pending.clear();
+  }
+
+  // tell the affected clients only
+  TQMap<WId, Q4Win10Client *>::ConstIterator it;
+  // without a table the per-window properties are read again: send all
+  // requests first, so the replies come in one round trip
+  if (m_version == 0)
+    for (it = m_clients.begin(); it != m_clients.end(); ++it)
+      requestHeight(it.key());
+  for (it = m_clients.begin(); it != m_clients.end(); ++it) {
+    const WId window = it.key();
+    int before = wasPublished ? (old.contains(window) ? old[window] : 0) : -1;
+    int after = height(window);
+    if (before != after)
+      it.data()->setMenuBarHeight(after);
+  }
+}
+
+int MenuBarTable::readWindowProperty(WId window) {
+  // send the request now unless it is already in flight
+  requestHeight(window);
+
+  TQMap<WId, unsigned int>::Iterator it = m_pending.find(window);
+  if (it == m_pending.end())
+    return 0;
+
+  xcb_connection_t *c = XGetXCBConnection(tqt_xdisplay());
+  xcb_get_property_cookie_t cookie;
+  cookie.sequence = it.data();
+  m_pending.remove(it);
+
+  TraceScope trace("menubarProperty", window);
+  int h = 0;
+  xcb_get_property_reply_t *reply = xcb_get_property_reply(c, cookie, 0);
+  if (reply) {
+    if (reply->type == XCB_ATOM_CARDINAL && reply->format == 32 &&
+        reply->value_len > 0) {
+      h = (int)*(const uint32_t *)xcb_get_property_value(reply);
+    }
+    free(reply);
+  }
+  Q4WIN10_PROBE2(menubar_reply, window, h);
+  return h;
+}
+
+} // namespace KWinQ4Win10
@@ -0,0 +1,81 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef Q4WIN10MENUBAR_H
+#define Q4WIN10MENUBAR_H
+
+#include <tqmap.h>
+#include <tqwidget.h>
+
+#include <X11/Xlib.h>
+
+namespace KWinQ4Win10 {
+
+class Q4Win10Client;
+
+/**
+ * Menubar heights pushed by the Q4Win10 style.
+ *
+ * The style publishes one table on the root window instead of a property
+ * per client window:
+ *
+ *   _Q4WIN10_MENUBAR_HEIGHTS, type CARDINAL, format 32
+ *     [0]          protocol version (MenuBarTableVersion)
+ *     [1]          number of entries n
+ *     [2 + 2 * i]  client window id
+ *     [3 + 2 * i]  menubar height in pixels
+ *
+ * The table is read once per PropertyNotify on the root window and only
+ * the clients whose entry changed are told about it. Without a table (an
+ * older style) the per-window _Q4WIN10_MENUBAR_HEIGHT property is read,
+ * and read again after each PropertyNotify for it on the client window.
+ * Those reads are pipelined: requestHeight() sends the XCB request right
+ * away and height() only waits for the reply, usually at the first paint.
+ */
+class MenuBarTable : public TQWidget {
+public:
+  MenuBarTable();
+  ~MenuBarTable();
+
+  void requestHeight(WId window);
+  int height(WId window);
+
+  void addClient(WId window, Q4Win10Client *client);
+  void removeClient(WId window);
+
+protected:
+  bool x11Event(XEvent *e);
+
+private:
+  void readTable();
+  int readWindowProperty(WId window);
+  void discardPending(WId window);
+  void selectPropertyChanges(WId window);
+
+  Atom m_tableAtom;
+  Atom m_windowAtom;
+  long m_version; // 0 = no table published
+  TQMap<WId, int> m_heights;
+  TQMap<WId, Q4Win10Client *> m_clients;
+  TQMap<WId, unsigned int> m_pending; // sequence numbers of XCB requests
+  TQMap<WId, unsigned int> m_masks;   // GetWindowAttributes not yet read
+};
+
+} // namespace KWinQ4Win10
+
+#endif // Q4WIN10MENUBAR_H
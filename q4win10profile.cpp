@@ -0,0 +1,259 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#include "q4win10profile.h"
+
+#ifdef Q4WIN10_PROFILE
+
+#include <tqwindowdefs.h>
+
+#include <X11/Xlib.h>
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace KWinQ4Win10 {
+
+static const unsigned int WarmupSamples = 16;
+static const unsigned int MaxSamples = 4096; // ring buffer per point
+
+static const char *const pointNames[NumProfilePoints] = {
+    "paintEvent",       "drawButton",    "pixmap",      "buttonBitmap",
+    "IconEngine::icon", "captionPixmap", "layoutMetric"};
+
+struct ProfileSamples {
+  unsigned long count; // including the warmup
+  unsigned int ns[MaxSamples];
+};
+
+static const char *const counterNames[NumProfileCounters] = {
+    "captionsCoalesced", "captionsDropped", "frameSwaps", "frameCacheDenied",
+    "iconCacheHits",     "iconCacheMisses"};
+
+static const char *const opNames[NumRequestOps] = {
+    "firstPaint", "repaint", "focusChange", "captionChange", "hover",
+    "maximize"};
+
+// X request budgets per operation, raise them only with a reason.
+//
+// Each budget is the count of the requests the code path sends, with about
+// a quarter on top for the toolkit (TQPainter sends a CreateGC and a FreeGC
+// per device, a ChangeGC per pen or brush change). A painted pixmap costs
+// about 6: CreatePixmap, CreateGC, two or three fills, FreeGC. The round
+// trips are the replies the path has to wait for, a reply that arrived
+// while the path did other work is free (see q4win10roundtrips.cpp and the
+// README, X Round Trips).
+struct RequestBudget {
+  unsigned long requests;
+  unsigned long roundTrips;
+};
+static const RequestBudget budgets[NumRequestOps] = {
+    // firstPaint: the 9 tiles of one state (54), the caption pixmap (8),
+    // title strip and borders copied or tiled to the window (14); menubar
+    // property reply, the icon read back with XGetImage on an icon cache
+    // miss
+    {96, 2},
+    // repaint after a geometry change: title strip rendered again from the
+    // tiles (24), caption copied (2), strip and 5 border pieces to the
+    // window (12), menubar property reply after a PropertyNotify or reset
+    {48, 1},
+    // focusChange: pointer QueryPointer sent, the reply and the repaint
+    // come later (1-3)
+    {8, 0},
+    // captionChange: caption pixmap of the current state rendered
+    // (CreatePixmap, GC, background tile, about 8) and its text drawn by
+    // Xft, which uploads the glyphs the server has not seen yet (up to 30
+    // for a new caption); the repaint is scheduled, font metrics are local
+    {48, 0},
+    // hover: one button face copied, or drawn when not cached yet (6-12)
+    {16, 0},
+    // maximize: the buttons moved with ConfigureWindow (5 by default), frame
+    // metrics are local, the repaint is scheduled
+    {16, 0},
+};
+
+struct RequestStats {
+  unsigned long calls;
+  unsigned long totalRequests;
+  unsigned long totalRoundTrips;
+  unsigned long maxRequests;
+  unsigned long maxRoundTrips;
+  unsigned long overBudget;
+};
+
+static ProfileSamples samples[NumProfilePoints];
+static unsigned long counters[NumProfileCounters];
+static RequestStats requestStats[NumRequestOps];
+
+static unsigned long now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static int compareSamples(const void *a, const void *b) {
+  const unsigned int x = *(const unsigned int *)a;
+  const unsigned int y = *(const unsigned int *)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// sorts v in place
+static unsigned int median(unsigned int *v, unsigned int n) {
+  qsort(v, n, sizeof(unsigned int), compareSamples);
+  return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+void Profiler::record(ProfilePoint point, unsigned long ns) {
+  ProfileSamples &s = samples[point];
+  if (s.count >= WarmupSamples)
+    s.ns[(s.count - WarmupSamples) % MaxSamples] = ns;
+  ++s.count;
+}
+
+void Profiler::count(ProfileCounter counter, unsigned long value) {
+  counters[counter] = value;
+}
+
+void Profiler::requests(RequestOp op, unsigned long requests,
+                        unsigned long roundTrips) {
+  RequestStats &s = requestStats[op];
+  ++s.calls;
+  s.totalRequests += requests;
+  s.totalRoundTrips += roundTrips;
+  s.maxRequests = TQMAX(s.maxRequests, requests);
+  s.maxRoundTrips = TQMAX(s.maxRoundTrips, roundTrips);
+
+  const RequestBudget &b = budgets[op];
+  if (requests > b.requests || roundTrips > b.roundTrips) {
+    ++s.overBudget;
+    fprintf(stderr,
+            "q4win10: %s took %lu requests and %lu round trips, budget is "
+            "%lu and %lu\n",
+            opNames[op], requests, roundTrips, b.requests, b.roundTrips);
+  }
+}
+
+// the counter of q4win10_roundtrips.so, 0 when it was not preloaded
+static const unsigned long *roundTripCounter() {
+  static const unsigned long *counter =
+      (const unsigned long *)dlsym(RTLD_DEFAULT, "q4win10_round_trips");
+  return counter;
+}
+
+bool Profiler::countsRoundTrips() { return roundTripCounter() != 0; }
+
+unsigned long Profiler::roundTrips() {
+  return roundTripCounter() ? *roundTripCounter() : 0;
+}
+
+unsigned long Profiler::requestBudget(RequestOp op) {
+  return budgets[op].requests;
+}
+
+unsigned long Profiler::roundTripBudget(RequestOp op) {
+  return budgets[op].roundTrips;
+}
+
+const char *Profiler::name(RequestOp op) { return opNames[op]; }
+
+unsigned long Profiler::calls(RequestOp op) { return requestStats[op].calls; }
+
+unsigned long Profiler::overBudget(RequestOp op) {
+  return requestStats[op].overBudget;
+}
+
+void Profiler::dump() {
+  const char *path = getenv("Q4WIN10_PROFILE_OUTPUT");
+  FILE *f = path ? fopen(path, "w") : stderr;
+  if (!f)
+    return;
+
+  static unsigned int v[MaxSamples];
+
+  fprintf(f, "{\"q4win10_profile\": [\n");
+  for (int p = 0; p < NumProfilePoints; ++p) {
+    const ProfileSamples &s = samples[p];
+    unsigned int n = 0;
+    if (s.count > WarmupSamples)
+      n = s.count - WarmupSamples < MaxSamples ? s.count - WarmupSamples
+                                               : MaxSamples;
+
+    unsigned int med = 0, mad = 0;
+    if (n > 0) {
+      memcpy(v, s.ns, n * sizeof(unsigned int));
+      med = median(v, n);
+      for (unsigned int i = 0; i < n; ++i)
+        v[i] = v[i] > med ? v[i] - med : med - v[i];
+      mad = median(v, n);
+    }
+
+    fprintf(f,
+            "  {\"name\": \"%s\", \"calls\": %lu, \"samples\": %u, "
+            "\"median_ns\": %u, \"mad_ns\": %u}%s\n",
+            pointNames[p], s.count, n, med, mad,
+            p + 1 < NumProfilePoints ? "," : "");
+  }
+  fprintf(f, "], \"round_trips_counted\": %s, \"requests\": [\n",
+          countsRoundTrips() ? "true" : "false");
+  for (int op = 0; op < NumRequestOps; ++op) {
+    const RequestStats &s = requestStats[op];
+    fprintf(f,
+            "  {\"name\": \"%s\", \"calls\": %lu, \"requests\": %lu, "
+            "\"round_trips\": %lu, \"max_requests\": %lu, "
+            "\"budget_requests\": %lu, \"max_round_trips\": %lu, "
+            "\"budget_round_trips\": %lu, \"over_budget\": %lu}%s\n",
+            opNames[op], s.calls, s.totalRequests, s.totalRoundTrips,
+            s.maxRequests, budgets[op].requests, s.maxRoundTrips,
+            budgets[op].roundTrips, s.overBudget,
+            op + 1 < NumRequestOps ? "," : "");
+  }
+  fprintf(f, "], \"counters\": {");
+  for (int c = 0; c < NumProfileCounters; ++c)
+    fprintf(f, "%s\"%s\": %lu", c ? ", " : "", counterNames[c], counters[c]);
+  fprintf(f, "}}\n");
+
+  if (f != stderr)
+    fclose(f);
+}
+
+ProfileScope::ProfileScope(ProfilePoint point)
+    : m_point(point), m_start(now()) {}
+
+ProfileScope::~ProfileScope() { Profiler::record(m_point, now() - m_start); }
+
+// Requests sent through XCB directly reach Xlib's counter only when Xlib
+// takes the socket back, the flush makes sure that has happened.
+static unsigned long nextRequest() {
+  XFlush(tqt_xdisplay());
+  return XNextRequest(tqt_xdisplay());
+}
+
+RequestScope::RequestScope(RequestOp op)
+    : m_op(op), m_request(nextRequest()), m_roundTrips(Profiler::roundTrips()) {
+}
+
+RequestScope::~RequestScope() {
+  Profiler::requests(m_op, nextRequest() - m_request,
+                     Profiler::roundTrips() - m_roundTrips);
+}
+
+} // namespace KWinQ4Win10
+
+#endif // Q4WIN10_PROFILE
@@ -0,0 +1,146 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef Q4WIN10PROFILE_H
+#define Q4WIN10PROFILE_H
+
+#ifdef Q4WIN10_SDT
+#include <sys/sdt.h>
+#endif
+
+namespace KWinQ4Win10 {
+
+enum ProfilePoint {
+  ProfPaintEvent = 0,
+  ProfDrawButton,
+  ProfPixmap,
+  ProfButtonBitmap,
+  ProfIconEngine,
+  ProfCaptionPixmap,
+  ProfLayoutMetric,
+  NumProfilePoints
+};
+
+// decoration operations with an X request budget
+enum RequestOp {
+  OpFirstPaint = 0,
+  OpRepaint,
+  OpFocusChange,
+  OpCaptionChange,
+  OpHover,
+  OpMaximize,
+  NumRequestOps
+};
+
+enum ProfileCounter {
+  CountCaptionsCoalesced = 0,
+  CountCaptionsDropped,
+  CountFrameSwaps,
+  CountFrameCacheDenied,
+  CountIconCacheHits,
+  CountIconCacheMisses,
+  NumProfileCounters
+};
+
+#ifdef Q4WIN10_PROFILE
+
+/**
+ * Timings of the hot functions, compiled in with -DQ4WIN10_PROFILE only.
+ *
+ * Every point keeps the last samples after a short warmup. When the plugin
+ * is unloaded the median and the median absolute deviation of each point
+ * are written as JSON to $Q4WIN10_PROFILE_OUTPUT (stderr if unset),
+ * together with the counters handed in by count().
+ *
+ * RequestScope counts the X requests (XNextRequest deltas) and the round
+ * trips of a decoration operation and checks them against the budgets in
+ * q4win10profile.cpp. Exceeding a budget is reported on stderr right away
+ * and counted in the dump. Round trips are counted by q4win10_roundtrips.so,
+ * which has to be preloaded; without it they read as 0.
+ */
+class Profiler {
+public:
+  static void record(ProfilePoint point, unsigned long ns);
+  static void count(ProfileCounter counter, unsigned long value);
+  static void requests(RequestOp op, unsigned long requests,
+                       unsigned long roundTrips);
+  static bool countsRoundTrips(); // q4win10_roundtrips.so is preloaded
+  static unsigned long roundTrips();
+  static unsigned long requestBudget(RequestOp op);
+  static unsigned long roundTripBudget(RequestOp op);
+  static const char *name(RequestOp op);
+  static unsigned long calls(RequestOp op);
+  static unsigned long overBudget(RequestOp op); // violations so far
+  static void dump();
+};
+
+class ProfileScope {
+public:
+  ProfileScope(ProfilePoint point);
+  ~ProfileScope();
+
+private:
+  ProfilePoint m_point;
+  unsigned long m_start;
+};
+
+class RequestScope {
+public:
+  RequestScope(RequestOp op);
+  ~RequestScope();
+
+private:
+  RequestOp m_op;
+  unsigned long m_request;
+  unsigned long m_roundTrips;
+};
+
+#define Q4WIN10_PROFILE_SCOPE(point) ProfileScope q4win10ProfileScope(point)
+#define Q4WIN10_REQUEST_SCOPE(op) RequestScope q4win10RequestScope(op)
+
+#else
+
+#define Q4WIN10_PROFILE_SCOPE(point)
+#define Q4WIN10_REQUEST_SCOPE(op)
+
+#endif // Q4WIN10_PROFILE
+
+/*
+ * USDT tracepoints of provider "q4win10" for perf and bpftrace, compiled in
+ * with -DQ4WIN10_SDT only. A probe that nobody attached to costs a nop.
+ */
+#ifdef Q4WIN10_SDT
+
+#define Q4WIN10_PROBE1(name, a) DTRACE_PROBE1(q4win10, name, a)
+#define Q4WIN10_PROBE2(name, a, b) DTRACE_PROBE2(q4win10, name, a, b)
+#define Q4WIN10_PROBE4(name, a, b, c, d) DTRACE_PROBE4(q4win10, name, a, b, c, d)
+#define Q4WIN10_PROBE5(name, a, b, c, d, e)                                    \
+  DTRACE_PROBE5(q4win10, name, a, b, c, d, e)
+
+#else
+
+#define Q4WIN10_PROBE1(name, a)
+#define Q4WIN10_PROBE2(name, a, b)
+#define Q4WIN10_PROBE4(name, a, b, c, d)
+#define Q4WIN10_PROBE5(name, a, b, c, d, e)
+
+#endif // Q4WIN10_SDT
+
+} // namespace KWinQ4Win10
+
+#endif // Q4WIN10PROFILE_H
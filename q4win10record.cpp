@@ -0,0 +1,204 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#include "q4win10record.h"
+
+#include <tqcstring.h>
+
+#include <byteswap.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+namespace KWinQ4Win10 {
+
+static const char RecordMagic[4] = {'Q', '4', 'W', 'R'};
+static const uint32_t RecordVersion = 1;
+
+// all fields in host byte order, the header tells the reader which one
+struct RecordHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t byteOrder; // 0x01020304
+  uint32_t recordSize;
+};
+
+struct RecordEntry {
+  uint32_t time; // usec since the previous record
+  uint8_t type;  // RecordType
+  uint8_t reserved;
+  uint16_t length; // payload bytes following the record
+  uint32_t window;
+  int32_t a, b, c, d;
+};
+
+static FILE *output;
+static uint64_t lastTime;
+
+bool Recorder::s_enabled = false;
+
+static uint64_t now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+void Recorder::init() {
+  const char *path = getenv("Q4WIN10_RECORD");
+  if (s_enabled || !path || !*path)
+    return;
+
+  output = fopen(path, "wb");
+  if (!output)
+    return;
+  // records are small, let stdio collect them
+  setvbuf(output, 0, _IOFBF, 64 * 1024);
+
+  RecordHeader header;
+  memcpy(header.magic, RecordMagic, sizeof(header.magic));
+  header.version = RecordVersion;
+  header.byteOrder = 0x01020304;
+  header.recordSize = sizeof(RecordEntry);
+  fwrite(&header, sizeof(header), 1, output);
+
+  lastTime = now();
+  s_enabled = true;
+}
+
+void Recorder::shutdown() {
+  if (!s_enabled)
+    return;
+
+  fclose(output);
+  output = 0;
+  s_enabled = false;
+}
+
+static void writeRecord(RecordType type, unsigned long window, int a, int b,
+                        int c, int d, const char *payload, uint16_t length) {
+  const uint64_t t = now();
+
+  RecordEntry e;
+  e.time = (uint32_t)TQMIN(t - lastTime, (uint64_t)0xffffffffu);
+  e.type = type;
+  e.reserved = 0;
+  e.length = length;
+  e.window = window;
+  e.a = a;
+  e.b = b;
+  e.c = c;
+  e.d = d;
+  fwrite(&e, sizeof(e), 1, output);
+  if (length)
+    fwrite(payload, length, 1, output);
+
+  lastTime = t;
+}
+
+void Recorder::record(RecordType type, unsigned long window, int a, int b,
+                      int c, int d) {
+  if (s_enabled)
+    writeRecord(type, window, a, b, c, d, 0, 0);
+}
+
+void Recorder::recordCaption(unsigned long window, const TQString &caption) {
+  if (!s_enabled)
+    return;
+
+  const TQCString utf8 = caption.utf8();
+  writeRecord(RecCaption, window, 0, 0, 0, 0, utf8.data(),
+              TQMIN(utf8.length(), 0xffffu));
+}
+
+RecordReader::RecordReader() : m_file(0), m_swap(false), m_recordSize(0) {}
+
+RecordReader::~RecordReader() { close(); }
+
+bool RecordReader::open(const char *path) {
+  close();
+  m_file = fopen(path, "rb");
+  if (!m_file)
+    return false;
+
+  RecordHeader header;
+  if (fread(&header, sizeof(header), 1, m_file) != 1 ||
+      memcmp(header.magic, RecordMagic, sizeof(header.magic))) {
+    close();
+    return false;
+  }
+  m_swap = header.byteOrder != 0x01020304;
+  if (m_swap) {
+    header.version = bswap_32(header.version);
+    header.recordSize = bswap_32(header.recordSize);
+  }
+  if (header.version != RecordVersion ||
+      header.recordSize < sizeof(RecordEntry)) {
+    close();
+    return false;
+  }
+  m_recordSize = header.recordSize;
+  return true;
+}
+
+void RecordReader::close() {
+  if (m_file)
+    fclose(m_file);
+  m_file = 0;
+}
+
+bool RecordReader::next(RecordEvent &e) {
+  if (!m_file)
+    return false;
+
+  RecordEntry r;
+  if (fread(&r, sizeof(r), 1, m_file) != 1)
+    return false;
+  if (m_swap) {
+    r.time = bswap_32(r.time);
+    r.length = bswap_16(r.length);
+    r.window = bswap_32(r.window);
+    r.a = bswap_32(r.a);
+    r.b = bswap_32(r.b);
+    r.c = bswap_32(r.c);
+    r.d = bswap_32(r.d);
+  }
+  // fields appended by later versions
+  if (m_recordSize > sizeof(r) &&
+      fseek(m_file, m_recordSize - sizeof(r), SEEK_CUR))
+    return false;
+
+  e.time = r.time;
+  e.type = (RecordType)r.type;
+  e.window = r.window;
+  e.a = r.a;
+  e.b = r.b;
+  e.c = r.c;
+  e.d = r.d;
+  e.caption = TQString();
+  if (r.length) {
+    TQCString payload(r.length + 1);
+    if (fread(payload.data(), r.length, 1, m_file) != 1)
+      return false;
+    e.caption = TQString::fromUtf8(payload.data(), r.length);
+  }
+  return true;
+}
+
+} // namespace KWinQ4Win10
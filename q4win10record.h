@@ -0,0 +1,92 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef Q4WIN10RECORD_H
+#define Q4WIN10RECORD_H
+
+#include <tqstring.h>
+
+#include <stdio.h>
+
+namespace KWinQ4Win10 {
+
+enum RecordType {
+  RecCreate = 1,
+  RecDestroy,
+  RecCaption, // payload: the caption in UTF-8
+  RecActive,  // a = active
+  RecGeometry, // a, b = width, height
+  RecMaximize, // a = maximize mode
+  RecMenuBar,  // a = menubar height
+  RecReset,    // a = changed settings
+  RecExpose    // a, b, c, d = x, y, width, height, one per region rect
+};
+
+/**
+ * Log of the events that drive the decorations, switched on at runtime by
+ * pointing $Q4WIN10_RECORD at the output file. The format is described in
+ * the README; it contains window titles, so treat recordings accordingly.
+ */
+class Recorder {
+public:
+  static void init();
+  static void shutdown();
+
+  static bool enabled() { return s_enabled; }
+
+  static void record(RecordType type, unsigned long window, int a = 0,
+                     int b = 0, int c = 0, int d = 0);
+  static void recordCaption(unsigned long window, const TQString &caption);
+
+private:
+  static bool s_enabled;
+};
+
+// one record of a log written by Recorder
+struct RecordEvent {
+  unsigned long time; // usec since the previous record
+  RecordType type;
+  unsigned long window;
+  int a, b, c, d;
+  TQString caption; // RecCaption only
+};
+
+/**
+ * Reads a log written by Recorder, in the byte order of the machine that
+ * wrote it. Used by the replay tool in tests/.
+ */
+class RecordReader {
+public:
+  RecordReader();
+  ~RecordReader();
+
+  // false if the file cannot be read or is not a log of a known version
+  bool open(const char *path);
+  void close();
+  // false at the end of the log or on a truncated record
+  bool next(RecordEvent &e);
+
+private:
+  FILE *m_file;
+  bool m_swap;                // written with the other byte order
+  unsigned int m_recordSize;  // may grow in later versions
+};
+
+} // namespace KWinQ4Win10
+
+#endif // Q4WIN10RECORD_H
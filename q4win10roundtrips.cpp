@@ -0,0 +1,69 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Round trip counter for profile builds, preloaded into twin or a test tool
+ * with LD_PRELOAD=q4win10_roundtrips.so. Every reply the client waits for
+ * ends in xcb_wait_for_reply() or xcb_wait_for_reply64(): the xcb_*_reply()
+ * functions, and Xlib's _XReply() behind XGetWindowProperty(), XGetImage(),
+ * XSync() and the like. A reply that has already arrived costs no wait and
+ * is not counted. RequestScope reads q4win10_round_trips (see
+ * q4win10profile.cpp); nothing else of the plugin is needed here.
+ */
+
+#include <tdemacros.h>
+
+#include <dlfcn.h>
+#include <stdint.h>
+#include <xcb/xcb.h>
+#include <xcb/xcbext.h>
+
+extern "C" {
+
+KDE_EXPORT unsigned long q4win10_round_trips = 0;
+
+typedef void *(*WaitForReply)(xcb_connection_t *, unsigned int,
+                              xcb_generic_error_t **);
+typedef void *(*WaitForReply64)(xcb_connection_t *, uint64_t,
+                                xcb_generic_error_t **);
+
+KDE_EXPORT void *
+xcb_wait_for_reply(xcb_connection_t *c, unsigned int request,
+                   xcb_generic_error_t **e) {
+  static WaitForReply next =
+      (WaitForReply)dlsym(RTLD_NEXT, "xcb_wait_for_reply");
+  void *reply = 0;
+  if (xcb_poll_for_reply(c, request, &reply, e))
+    return reply;
+  ++q4win10_round_trips;
+  return next(c, request, e);
+}
+
+KDE_EXPORT void *
+xcb_wait_for_reply64(xcb_connection_t *c, uint64_t request,
+                     xcb_generic_error_t **e) {
+  static WaitForReply64 next =
+      (WaitForReply64)dlsym(RTLD_NEXT, "xcb_wait_for_reply64");
+  void *reply = 0;
+  if (xcb_poll_for_reply64(c, request, &reply, e))
+    return reply;
+  ++q4win10_round_trips;
+  return next(c, request, e);
+}
+
+} // extern "C"
@@ -0,0 +1,127 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#include "q4win10trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace KWinQ4Win10 {
+
+static const unsigned int RingSize = 16384; // events, power of two
+
+struct TraceEvent {
+  const char *name;
+  unsigned long start;
+  unsigned long duration;
+  unsigned long window;
+  int width;
+  int height;
+};
+
+static TraceEvent ring[RingSize];
+static unsigned long head; // next event to write
+static unsigned long tail; // next event to flush
+static unsigned long overwritten;
+static FILE *output;
+static bool firstEvent = true;
+
+bool Tracer::s_enabled = false;
+
+void Tracer::init() {
+  const char *path = getenv("Q4WIN10_TRACE");
+  if (s_enabled || !path || !*path)
+    return;
+
+  output = fopen(path, "w");
+  if (!output)
+    return;
+
+  // the array format, viewers accept a missing closing bracket should twin
+  // not get to shutdown()
+  fprintf(output, "[\n");
+  s_enabled = true;
+}
+
+unsigned long Tracer::now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+}
+
+void Tracer::complete(const char *name, unsigned long start,
+                      unsigned long window, int width, int height) {
+  // no locking, the decoration only runs on the GUI thread
+  if (head - tail == RingSize) {
+    ++tail;
+    ++overwritten;
+  }
+
+  TraceEvent &e = ring[head % RingSize];
+  e.name = name;
+  e.start = start;
+  e.duration = now() - start;
+  e.window = window;
+  e.width = width;
+  e.height = height;
+  ++head;
+}
+
+void Tracer::flush() {
+  if (!s_enabled)
+    return;
+
+  const int pid = getpid();
+  for (; tail != head; ++tail) {
+    const TraceEvent &e = ring[tail % RingSize];
+    fprintf(output,
+            "%s{\"name\": \"%s\", \"cat\": \"q4win10\", \"ph\": \"X\", "
+            "\"ts\": %lu, \"dur\": %lu, \"pid\": %d, \"tid\": %d, "
+            "\"args\": {\"window\": \"0x%lx\", \"width\": %d, "
+            "\"height\": %d}}\n",
+            firstEvent ? "" : ",", e.name, e.start, e.duration, pid, pid,
+            e.window, e.width, e.height);
+    firstEvent = false;
+  }
+
+  if (overwritten) {
+    fprintf(output,
+            "%s{\"name\": \"overwritten\", \"ph\": \"i\", \"ts\": %lu, "
+            "\"pid\": %d, \"tid\": %d, \"s\": \"p\", "
+            "\"args\": {\"events\": %lu}}\n",
+            firstEvent ? "" : ",", now(), pid, pid, overwritten);
+    firstEvent = false;
+    overwritten = 0;
+  }
+  fflush(output);
+}
+
+void Tracer::shutdown() {
+  if (!s_enabled)
+    return;
+
+  flush();
+  fprintf(output, "]\n");
+  fclose(output);
+  output = 0;
+  s_enabled = false;
+}
+
+} // namespace KWinQ4Win10
@@ -0,0 +1,77 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef Q4WIN10TRACE_H
+#define Q4WIN10TRACE_H
+
+namespace KWinQ4Win10 {
+
+/**
+ * Timeline of the decoration work in Chrome trace event format, switched on
+ * at runtime by pointing $Q4WIN10_TRACE at the output file.
+ *
+ * Events go into a fixed ring buffer on the GUI thread and are written out
+ * by flush(), which the handler calls from a timer, never from a paint. If
+ * the ring fills up between two flushes the oldest events are overwritten.
+ * Open the file in chrome://tracing or ui.perfetto.dev.
+ */
+class Tracer {
+public:
+  static void init();
+  static void flush();
+  static void shutdown();
+
+  static bool enabled() { return s_enabled; }
+  static unsigned long now(); // usec
+
+  // a finished slice, name must be a string literal
+  static void complete(const char *name, unsigned long start,
+                       unsigned long window, int width, int height);
+
+private:
+  static bool s_enabled;
+};
+
+class TraceScope {
+public:
+  TraceScope(const char *name, unsigned long window = 0, int width = 0,
+             int height = 0)
+      : m_name(name), m_window(window), m_width(width), m_height(height),
+        m_start(Tracer::enabled() ? Tracer::now() : 0) {}
+  ~TraceScope() {
+    if (m_start)
+      Tracer::complete(m_name, m_start, m_window, m_width, m_height);
+  }
+
+  // for slices whose size is only known at the end
+  void setSize(int width, int height) {
+    m_width = width;
+    m_height = height;
+  }
+
+private:
+  const char *m_name;
+  unsigned long m_window;
+  int m_width;
+  int m_height;
+  unsigned long m_start;
+};
+
+} // namespace KWinQ4Win10
+
+#endif // Q4WIN10TRACE_H
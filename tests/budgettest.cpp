@@ -0,0 +1,237 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * X request budgets of a profile build, on a real decoration: first paint,
+ * repaint, focus change, caption change, hover and maximize are driven
+ * through the harness, and none of them may go over its request or round
+ * trip budget. Then an operation is pushed over its budget by hand, which
+ * must be reported on stderr and counted in the dump.
+ *
+ * Built with -DQ4WIN10_PROFILE, run with LD_PRELOAD=q4win10_roundtrips.so
+ * (see q4win10roundtrips.cpp) on an X display, e.g. Xvfb.
+ */
+
+#include <tqapplication.h>
+#include <tqevent.h>
+#include <tqpixmap.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../q4win10button.h"
+#include "../q4win10client.h"
+#include "../q4win10profile.h"
+#include "harness.h"
+
+#ifndef Q4WIN10_PROFILE
+#error "the budget test needs -DQ4WIN10_PROFILE"
+#endif
+
+using namespace KWinQ4Win10;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #cond);        \
+      ++failures;                                                              \
+    }                                                                          \
+  } while (0)
+
+// reads a whole file into buf, returns false if it cannot be read
+static bool readFile(const char *path, char *buf, size_t size) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return false;
+  const size_t n = fread(buf, 1, size - 1, f);
+  buf[n] = 0;
+  fclose(f);
+  return true;
+}
+
+// the line of op in the requests section of the dump
+static const char *dumpLine(const char *dump, const char *op) {
+  char key[64];
+  snprintf(key, sizeof(key), "{\"name\": \"%s\", \"calls\"", op);
+  return strstr(dump, key);
+}
+
+static unsigned long dumpField(const char *line, const char *field) {
+  char key[64];
+  snprintf(key, sizeof(key), "\"%s\": ", field);
+  const char *end = line ? strchr(line, '}') : 0;
+  const char *p = line ? strstr(line, key) : 0;
+  if (!p || p > end)
+    return (unsigned long)-1;
+  return strtoul(p + strlen(key), 0, 10);
+}
+
+// the operations of the budget table, each at least once
+static void drive(Harness &harness) {
+  MockBridge bridge;
+  // not in the icon cache (no WM_CLASS), so every first paint reads it back
+  TQPixmap icon(32, 32);
+  icon.fill(TQColor(0, 120, 215));
+  bridge.windowIcon = TQIconSet(icon);
+
+  // firstPaint
+  Q4Win10Client *client = harness.createClient(&bridge);
+  WindowState old = bridge.state;
+
+  // repaint after a geometry change
+  bridge.state.width += 120;
+  harness.applyState(client, &bridge, old);
+  harness.flush();
+
+  // focusChange, both ways
+  for (int i = 0; i < 2; ++i) {
+    old = bridge.state;
+    bridge.state.active = !bridge.state.active;
+    harness.applyState(client, &bridge, old);
+    harness.flush();
+  }
+
+  // captionChange, rendered in the idle batch
+  old = bridge.state;
+  bridge.state.caption = "Budget test - a caption the server has not seen";
+  harness.applyState(client, &bridge, old);
+  harness.flush();
+
+  // hover on every button
+  const TQMemArray<Q4Win10Button *> b = harness.buttons(client);
+  for (uint i = 0; i < b.size(); ++i) {
+    TQEvent enter(TQEvent::Enter);
+    TQApplication::sendEvent(b[i], &enter);
+    harness.flush();
+    TQEvent leave(TQEvent::Leave);
+    TQApplication::sendEvent(b[i], &leave);
+    harness.flush();
+  }
+
+  // maximize and restore
+  for (int i = 0; i < 2; ++i) {
+    old = bridge.state;
+    bridge.state.maximized = !bridge.state.maximized;
+    harness.applyState(client, &bridge, old);
+    harness.flush();
+  }
+
+  harness.destroyClient(client);
+}
+
+int main() {
+  if (!Profiler::countsRoundTrips()) {
+    fprintf(stderr, "round trips are not counted, run with "
+                    "LD_PRELOAD=q4win10_roundtrips.so\n");
+    return 1;
+  }
+
+  // the handler writes a dump when it goes away, only the one below counts
+  setenv("Q4WIN10_PROFILE_OUTPUT", "/dev/null", 1);
+  {
+    Harness harness("q4win10_budgettest");
+    // hover repaints right away, captions are not held back
+    harness.setConfig("AnimateButtons", "false");
+    harness.setConfig("MaxCaptionRate", "0");
+    drive(harness);
+  }
+
+  // the violations, if any, have been reported on stderr already
+  for (int op = 0; op < NumRequestOps; ++op) {
+    const RequestOp o = RequestOp(op);
+    if (Profiler::calls(o) == 0) {
+      fprintf(stderr, "%s did not run\n", Profiler::name(o));
+      ++failures;
+    }
+    if (Profiler::overBudget(o) > 0) {
+      fprintf(stderr, "%s went over budget %lu times\n", Profiler::name(o),
+              Profiler::overBudget(o));
+      ++failures;
+    }
+  }
+
+  char stderrPath[] = "/tmp/q4win10-budget-stderr-XXXXXX";
+  char dumpPath[] = "/tmp/q4win10-budget-dump-XXXXXX";
+  const int stderrFd = mkstemp(stderrPath);
+  const int dumpFd = mkstemp(dumpPath);
+  if (stderrFd < 0 || dumpFd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+  close(dumpFd);
+
+  // catch what the profiler reports right away
+  fflush(stderr);
+  const int savedStderr = dup(2);
+  dup2(stderrFd, 2);
+
+  // by hand: within budget is silent
+  Profiler::requests(OpHover, Profiler::requestBudget(OpHover),
+                     Profiler::roundTripBudget(OpHover));
+  // one request too many
+  Profiler::requests(OpRepaint, Profiler::requestBudget(OpRepaint) + 1, 0);
+  // a round trip where none is allowed
+  Profiler::requests(OpFocusChange, 1,
+                     Profiler::roundTripBudget(OpFocusChange) + 1);
+
+  fflush(stderr);
+  dup2(savedStderr, 2);
+  close(savedStderr);
+  close(stderrFd);
+
+  CHECK(Profiler::overBudget(OpHover) == 0);
+  CHECK(Profiler::overBudget(OpRepaint) == 1);
+  CHECK(Profiler::overBudget(OpFocusChange) == 1);
+
+  static char buf[16384];
+  CHECK(readFile(stderrPath, buf, sizeof(buf)));
+  CHECK(!strstr(buf, "q4win10: hover"));
+  CHECK(strstr(buf, "q4win10: repaint took"));
+  CHECK(strstr(buf, "q4win10: focusChange took"));
+
+  setenv("Q4WIN10_PROFILE_OUTPUT", dumpPath, 1);
+  Profiler::dump();
+  CHECK(readFile(dumpPath, buf, sizeof(buf)));
+  CHECK(strstr(buf, "\"round_trips_counted\": true"));
+
+  const char *hover = dumpLine(buf, "hover");
+  const char *repaint = dumpLine(buf, "repaint");
+  const char *focus = dumpLine(buf, "focusChange");
+  CHECK(hover && repaint && focus);
+  CHECK(dumpField(hover, "over_budget") == 0);
+  CHECK(dumpField(repaint, "over_budget") == 1);
+  CHECK(dumpField(repaint, "max_requests") ==
+        Profiler::requestBudget(OpRepaint) + 1);
+  CHECK(dumpField(focus, "over_budget") == 1);
+  CHECK(dumpField(focus, "max_round_trips") ==
+        Profiler::roundTripBudget(OpFocusChange) + 1);
+
+  unlink(stderrPath);
+  unlink(dumpPath);
+
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  printf("budgets OK\n");
+  return 0;
+}
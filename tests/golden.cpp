@@ -0,0 +1,284 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Golden-image test of the decoration, without twin.
+ *
+ *   q4win10_golden [--golden DIR] [--update] [--reps N] [--output FILE]
+ *
+ * Every state is rendered on the current display, grabbed and compared
+ * pixel by pixel with DIR/<state>.png. A mismatch is written next to the
+ * reference as <state>.actual.png and makes the exit status 1, so is a
+ * missing reference. --update writes the references instead.
+ *
+ * The render time of each state, cold (tile and caption caches empty) and
+ * the median and MAD of N warm repaints (10), goes to FILE as JSON.
+ */
+
+#include <tqapplication.h>
+#include <tqfile.h>
+#include <tqimage.h>
+#include <tqstring.h>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../q4win10button.h"
+#include "../q4win10client.h"
+#include "harness.h"
+
+using namespace KWinQ4Win10;
+
+#ifndef Q4WIN10_GOLDEN_DIR
+#define Q4WIN10_GOLDEN_DIR "tests/golden"
+#endif
+
+static const char *goldenDir = Q4WIN10_GOLDEN_DIR;
+static bool updateReferences = false;
+static int reps = 10;
+static int failures = 0;
+static FILE *output = 0;
+static bool firstSample = true;
+
+static const int MenuBarHeight = 20;
+
+static const char *const buttonNames[NumButtons] = {
+    "help",          "max",   "min",   "close", "menu",
+    "onAllDesktops", "above", "below", "shade"};
+
+// Built with Q4WIN10_GOLDEN_BASELINE against older sources to generate the
+// references (see golden/generate.sh). Those read the menubar height from
+// the window property at every paint and follow the pointer for the hover.
+static void setMenuBarHeight(Q4Win10Client *client, MockBridge &bridge,
+                             int height) {
+#ifdef Q4WIN10_GOLDEN_BASELINE
+  Display *dpy = tqt_xdisplay();
+  const Atom atom = XInternAtom(dpy, "_Q4WIN10_MENUBAR_HEIGHT", False);
+  if (height > 0) {
+    const long value = height;
+    XChangeProperty(dpy, bridge.windowId(), atom, XA_CARDINAL, 32,
+                    PropModeReplace, (const unsigned char *)&value, 1);
+  } else {
+    XDeleteProperty(dpy, bridge.windowId(), atom);
+  }
+  XSync(dpy, False);
+  client->widget()->repaint(false);
+#else
+  (void)bridge;
+  client->setMenuBarHeight(height);
+#endif
+}
+
+static void setHover(Q4Win10Button *b, bool hover) {
+#ifdef Q4WIN10_GOLDEN_BASELINE
+  TQEvent e(hover ? TQEvent::Enter : TQEvent::Leave);
+  TQApplication::sendEvent(b, &e);
+#else
+  b->setHover(hover);
+#endif
+}
+
+static bool samePixels(const TQImage &a, const TQImage &b, int &x, int &y) {
+  if (a.size() != b.size()) {
+    x = y = -1;
+    return false;
+  }
+  for (y = 0; y < a.height(); ++y)
+    for (x = 0; x < a.width(); ++x)
+      if ((a.pixel(x, y) & 0xffffff) != (b.pixel(x, y) & 0xffffff))
+        return false;
+  return true;
+}
+
+// the decoration as it is now, against DIR/name.png
+static void check(Harness &harness, Q4Win10Client *client,
+                  const TQString &name) {
+  harness.flush();
+  const TQImage actual = harness.grab(client).convertDepth(32);
+  const TQString path = TQString("%1/%2.png").arg(goldenDir).arg(name);
+
+  if (updateReferences) {
+    if (!actual.save(path, "PNG")) {
+      fprintf(stderr, "%s: cannot write\n", path.latin1());
+      ++failures;
+    }
+    return;
+  }
+
+  TQImage reference;
+  if (!reference.load(path)) {
+    fprintf(stderr, "%s: no reference, run with --update\n", path.latin1());
+    ++failures;
+    return;
+  }
+  int x, y;
+  if (!samePixels(actual, reference.convertDepth(32), x, y)) {
+    if (x < 0)
+      fprintf(stderr, "%s: %dx%d, reference is %dx%d\n", name.latin1(),
+              actual.width(), actual.height(), reference.width(),
+              reference.height());
+    else
+      fprintf(stderr, "%s: first difference at %d,%d\n", name.latin1(), x,
+              y);
+    actual.save(TQString("%1/%2.actual.png").arg(goldenDir).arg(name), "PNG");
+    ++failures;
+  }
+}
+
+// cold and warm render times of the current state
+static void timeState(Harness &harness, Q4Win10Client *client,
+                 const TQString &name) {
+  HarnessAccess::clearTileCache(harness.handler());
+  HarnessAccess::clearCaptionPixmaps(client);
+  Samples cold;
+  cold.add(harness.repaint(client));
+
+  Samples warm;
+  for (int i = 0; i < reps; ++i)
+    warm.add(harness.repaint(client));
+
+  if (!output)
+    return;
+  if (!firstSample)
+    fprintf(output, ",\n");
+  firstSample = false;
+  writeSample(output, name + "/cold", cold, false);
+  writeSample(output, name + "/warm", warm, true);
+}
+
+static void testState(Harness &harness, Q4Win10Client *client,
+                      const TQString &name) {
+  timeState(harness, client, name);
+  check(harness, client, name);
+}
+
+// the whole window in every combination, then each button hovered and
+// pressed on normal windows
+static void testClient(Harness &harness, bool dark, bool tool) {
+  MockBridge bridge;
+  bridge.state.width = 400;
+  bridge.state.height = 300;
+  bridge.state.toolWindow = tool;
+  Q4Win10Client *client = harness.createClient(&bridge);
+
+  const TQString prefix = TQString("%1-%2")
+                             .arg(dark ? "dark" : "light")
+                             .arg(tool ? "tool" : "normal");
+
+  for (int active = 1; active >= 0; --active)
+    for (int maximized = 0; maximized < 2; ++maximized)
+      for (int menuBar = 0; menuBar < 2; ++menuBar) {
+        const WindowState old = bridge.state;
+        bridge.state.active = active;
+        bridge.state.maximized = maximized;
+        harness.applyState(client, &bridge, old);
+        setMenuBarHeight(client, bridge, menuBar ? MenuBarHeight : 0);
+        testState(harness, client,
+                  TQString("%1-%2-%3-%4")
+                      .arg(prefix)
+                      .arg(active ? "active" : "inactive")
+                      .arg(maximized ? "maximized" : "restored")
+                      .arg(menuBar ? "menubar" : "nomenubar"));
+      }
+
+  if (!tool) {
+    WindowState old = bridge.state;
+    bridge.state.maximized = false;
+    harness.applyState(client, &bridge, old);
+    setMenuBarHeight(client, bridge, 0);
+    for (int active = 1; active >= 0; --active) {
+      old = bridge.state;
+      bridge.state.active = active;
+      harness.applyState(client, &bridge, old);
+
+      const TQMemArray<Q4Win10Button *> buttons = harness.buttons(client);
+      for (uint i = 0; i < buttons.size(); ++i) {
+        Q4Win10Button *b = buttons[i];
+        const TQString name = TQString("%1-%2-%3")
+                                  .arg(prefix)
+                                  .arg(active ? "active" : "inactive")
+                                  .arg(buttonNames[b->type()]);
+        setHover(b, true);
+        testState(harness, client, name + "-hover");
+        b->setDown(true);
+        testState(harness, client, name + "-pressed");
+        b->setDown(false);
+        setHover(b, false);
+      }
+    }
+  }
+
+  harness.destroyClient(client);
+}
+
+static void usage() {
+  fprintf(stderr, "usage: q4win10_golden [--golden DIR] [--update] "
+                  "[--reps N] [--output FILE]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *outputPath = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--update"))
+      updateReferences = true;
+    else if (i + 1 >= argc)
+      usage();
+    else if (!strcmp(argv[i], "--golden"))
+      goldenDir = argv[++i];
+    else if (!strcmp(argv[i], "--reps"))
+      reps = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--output"))
+      outputPath = argv[++i];
+    else
+      usage();
+  }
+  if (reps < 1)
+    usage();
+
+  Harness harness("q4win10_golden");
+  // every state is painted right away, without fades and rate limits
+  harness.setConfig("AnimateButtons", "false");
+  harness.setConfig("MaxCaptionRate", "0");
+
+  if (outputPath) {
+    output = fopen(outputPath, "w");
+    if (!output) {
+      perror(outputPath);
+      return 2;
+    }
+    fprintf(output, "{\"q4win10_golden\": [\n");
+  }
+
+  for (int dark = 0; dark < 2; ++dark) {
+    harness.setDarkMode(dark);
+    for (int tool = 0; tool < 2; ++tool)
+      testClient(harness, dark, tool);
+  }
+
+  if (output) {
+    fprintf(output, "]}\n");
+    fclose(output);
+  }
+  if (failures)
+    fprintf(stderr, "%d states differ from the references\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+#!/bin/bash
+
+# Generates the golden references from the plugin as it was before the
+# paint path changes, on a pinned Xvfb, and checks the current tree
+# against them (see README, Golden Images).
+#
+#   tests/golden/generate.sh [-d DISPLAY] [COMMIT]
+#
+# COMMIT defaults to the baseline 9c7f4b4. Its sources are checked out in a
+# temporary worktree and built together with the current tests/harness.cpp
+# and tests/golden.cpp (-DQ4WIN10_GOLDEN_BASELINE). The PNGs land in
+# tests/golden/, SOURCE.txt next to them records how they were made.
+#
+# Needs Xvfb, xprop, fc-match, git and the build environment of the
+# Makefile; the fonts below must be installed (fonts-dejavu-core).
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+REPO="$(cd "$SCRIPT_DIR/../.." && pwd)"
+DISPLAY_NAME=":99"
+
+while getopts "d:" opt; do
+    case $opt in
+        d) DISPLAY_NAME="$OPTARG" ;;
+        *) echo "usage: $0 [-d DISPLAY] [COMMIT]" >&2; exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+COMMIT="${1:-9c7f4b4}"
+
+# the pinned setup: depth, resolution, DPI, and only the DejaVu fonts
+XVFB_ARGS="-screen 0 1280x1024x24 -dpi 96 -nolisten tcp -fp built-ins"
+FONT_DIR="/usr/share/fonts/truetype/dejavu"
+
+for tool in Xvfb xprop fc-match git; do
+    if ! command -v "$tool" >/dev/null 2>&1; then
+        echo "$0: $tool not found" >&2
+        exit 2
+    fi
+done
+if [ ! -d "$FONT_DIR" ]; then
+    echo "$0: $FONT_DIR not found" >&2
+    exit 2
+fi
+
+WORK="$(mktemp -d /tmp/q4win10-golden-XXXXXX)"
+cleanup() {
+    [ -n "$XVFB_PID" ] && kill "$XVFB_PID" 2>/dev/null
+    git -C "$REPO" worktree remove --force "$WORK/src" 2>/dev/null || true
+    rm -rf "$WORK"
+}
+trap cleanup EXIT
+
+# fontconfig sees nothing but the pinned fonts, whatever the machine has
+cat > "$WORK/fonts.conf" <<FONTS
+<?xml version="1.0"?>
+<!DOCTYPE fontconfig SYSTEM "fonts.dtd">
+<fontconfig>
+  <dir>$FONT_DIR</dir>
+  <cachedir>$WORK/fontcache</cachedir>
+  <match target="font">
+    <edit name="antialias" mode="assign"><bool>true</bool></edit>
+    <edit name="hinting" mode="assign"><bool>true</bool></edit>
+    <edit name="hintstyle" mode="assign"><const>hintslight</const></edit>
+    <edit name="rgba" mode="assign"><const>none</const></edit>
+  </match>
+</fontconfig>
+FONTS
+export FONTCONFIG_FILE="$WORK/fonts.conf"
+
+# the old sources with today's harness; the old Makefile has the flags
+git -C "$REPO" worktree add --detach "$WORK/src" "$COMMIT" >/dev/null
+mkdir -p "$WORK/src/tests"
+cp "$REPO/tests/harness.h" "$REPO/tests/harness.cpp" "$REPO/tests/golden.cpp" \
+    "$WORK/src/tests/"
+cat > "$WORK/src/golden.mk" <<'MAKE'
+include Makefile
+golden-baseline: $(MAIN_MOCS)
+	$(CXX) $(filter-out -fPIC,$(CXXFLAGS)) -Itests -DQ4WIN10_GOLDEN_BASELINE \
+	    $(MAIN_SRCS) tests/harness.cpp tests/golden.cpp \
+	    -o tests/q4win10_golden $(filter-out -shared,$(LDFLAGS)) -lX11
+MAKE
+# the worktree is not inside the tdebase tree, TDEBASE is the one of $REPO
+make -s -C "$WORK/src" -f golden.mk golden-baseline \
+    TDEBASE="$(cd "$REPO/../../.." && pwd)"
+make -s -C "$REPO" tests/q4win10_golden
+
+export DISPLAY="$DISPLAY_NAME"
+Xvfb "$DISPLAY" $XVFB_ARGS 2>/dev/null &
+XVFB_PID=$!
+for i in $(seq 50); do
+    xprop -root >/dev/null 2>&1 && break
+    sleep 0.1
+done
+
+rm -f "$SCRIPT_DIR"/*.png
+"$WORK/src/tests/q4win10_golden" --golden "$SCRIPT_DIR" --update --reps 1
+
+{
+    echo "Generated by tests/golden/generate.sh"
+    echo "sources:  $(git -C "$REPO" rev-parse "$COMMIT") with the harness of $(git -C "$REPO" rev-parse --short HEAD)"
+    echo "Xvfb:     $XVFB_ARGS ($(Xvfb -version 2>&1 | grep -i 'release' | head -n 1))"
+    echo "fonts:    $FONT_DIR only, grayscale antialiasing, slight hinting"
+    echo "title:    $(fc-match 'Sans:bold')"
+    echo "fontconfig $(fc-match --version 2>&1 | head -n 1 | sed 's/.*version //')"
+    for f in "$FONT_DIR"/DejaVuSans.ttf "$FONT_DIR"/DejaVuSans-Bold.ttf; do
+        echo "  $(sha256sum "$f")"
+    done
+} > "$SCRIPT_DIR/SOURCE.txt"
+
+# the current tree must paint the same pixels
+if "$REPO/tests/q4win10_golden" --golden "$SCRIPT_DIR" --output "$WORK/golden.json"; then
+    echo "references written, the current tree matches them"
+else
+    echo "references written, the current tree differs (see *.actual.png)" >&2
+    exit 1
+fi
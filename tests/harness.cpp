@@ -0,0 +1,345 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#include "harness.h"
+
+#include <kdecoration_p.h>
+#include <tdeaboutdata.h>
+#include <tdeapplication.h>
+#include <tdecmdlineargs.h>
+#include <tdeconfig.h>
+#include <tqdatetime.h>
+#include <tqdesktopwidget.h>
+#include <tqobjectlist.h>
+#include <tqpixmap.h>
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "../q4win10button.h"
+#include "../q4win10client.h"
+
+extern "C" KDecorationFactory *create_factory();
+
+namespace KWinQ4Win10 {
+
+WindowState::WindowState()
+    : active(true), toolWindow(false), maximized(false),
+      caption("Document - Editor"), width(640), height(480), x11Screen(-1) {}
+
+MockBridge::MockBridge() {
+  Display *dpy = tqt_xdisplay();
+  m_window = XCreateSimpleWindow(dpy, DefaultRootWindow(dpy), 0, 0, 1, 1, 0,
+                                 0, 0);
+}
+
+MockBridge::~MockBridge() { XDestroyWindow(tqt_xdisplay(), m_window); }
+
+bool MockBridge::isActive() const { return state.active; }
+bool MockBridge::isCloseable() const { return true; }
+bool MockBridge::isMaximizable() const { return true; }
+KDecorationDefines::MaximizeMode MockBridge::maximizeMode() const {
+  return state.maximized ? MaximizeFull : MaximizeRestore;
+}
+bool MockBridge::isMinimizable() const { return true; }
+bool MockBridge::providesContextHelp() const { return true; }
+int MockBridge::desktop() const { return 1; }
+bool MockBridge::isModal() const { return false; }
+bool MockBridge::isShadeable() const { return true; }
+bool MockBridge::isShade() const { return false; }
+bool MockBridge::isSetShade() const { return false; }
+bool MockBridge::keepAbove() const { return false; }
+bool MockBridge::keepBelow() const { return false; }
+bool MockBridge::isMovable() const { return true; }
+bool MockBridge::isResizable() const { return true; }
+NET::WindowType MockBridge::windowType(unsigned long) const {
+  return state.toolWindow ? NET::Utility : NET::Normal;
+}
+TQIconSet MockBridge::icon() const { return windowIcon; }
+TQString MockBridge::caption() const { return state.caption; }
+void MockBridge::processMousePressEvent(TQMouseEvent *) {}
+void MockBridge::showWindowMenu(const TQRect &) {}
+void MockBridge::showWindowMenu(TQPoint) {}
+void MockBridge::performWindowOperation(WindowOperation) {}
+void MockBridge::setMask(const TQRegion &, int) {}
+bool MockBridge::isPreview() const { return false; }
+TQRect MockBridge::geometry() const {
+  return TQRect(0, 0, state.width, state.height);
+}
+TQRect MockBridge::iconGeometry() const { return TQRect(); }
+TQRegion MockBridge::unobscuredRegion(const TQRegion &r) const { return r; }
+TQWidget *MockBridge::workspaceWidget() const { return 0; }
+WId MockBridge::windowId() const { return m_window; }
+void MockBridge::closeWindow() {}
+void MockBridge::maximize(MaximizeMode) {}
+void MockBridge::minimize() {}
+void MockBridge::showContextHelp() {}
+void MockBridge::setDesktop(int) {}
+void MockBridge::titlebarDblClickOperation() {}
+void MockBridge::titlebarMouseWheelOperation(int) {}
+void MockBridge::setShade(bool) {}
+void MockBridge::setKeepAbove(bool) {}
+void MockBridge::setKeepBelow(bool) {}
+int MockBridge::currentDesktop() const { return 1; }
+// a top level with the desktop widget of another screen as parent goes to
+// that screen
+TQWidget *MockBridge::initialParentWidget() const {
+  if (state.x11Screen < 0)
+    return 0;
+  return TQApplication::desktop()->screen(state.x11Screen);
+}
+// no window manager runs on the harness display, nothing would map a normal
+// top level at a known place
+TQt::WFlags MockBridge::initialWFlags() const {
+  return state.x11Screen >= 0 ? TQt::WType_TopLevel | TQt::WX11BypassWM
+                              : TQt::WX11BypassWM;
+}
+void MockBridge::helperShowHide(bool) {}
+void MockBridge::grabXServer(bool) {}
+
+#ifndef Q4WIN10_GOLDEN_BASELINE
+void HarnessAccess::clearTileCache(Q4Win10Handler *handler) {
+  handler->m_tileSets.clear();
+}
+
+const TQPixmap &HarnessAccess::captionPixmap(Q4Win10Client *client,
+                                             bool active) {
+  return client->captionPixmap(active);
+}
+
+void HarnessAccess::clearCaptionPixmaps(Q4Win10Client *client) {
+  client->clearCaptionPixmaps();
+}
+
+void HarnessAccess::prerenderFrame(Q4Win10Client *client) {
+  client->prerenderFrame();
+}
+
+int HarnessAccess::pendingCaptions(Q4Win10Handler *handler) {
+  return handler->m_pendingCaptions.count();
+}
+#else
+// built against the sources of tests/golden/generate.sh, which have none of
+// these caches; only the timings of q4win10_golden depend on them
+void HarnessAccess::clearTileCache(Q4Win10Handler *) {}
+
+const TQPixmap &HarnessAccess::captionPixmap(Q4Win10Client *, bool) {
+  static TQPixmap none;
+  return none;
+}
+
+void HarnessAccess::clearCaptionPixmaps(Q4Win10Client *) {}
+
+void HarnessAccess::prerenderFrame(Q4Win10Client *) {}
+
+int HarnessAccess::pendingCaptions(Q4Win10Handler *) { return 0; }
+#endif
+
+// the built-in twin defaults, like the decoration preview of the control
+// module uses before it has read twinrc
+class HarnessOptions : public KDecorationOptions {
+public:
+  HarnessOptions() {
+    d = new KDecorationOptionsPrivate;
+    d->defaultKWinSettings();
+  }
+  virtual ~HarnessOptions() { delete d; }
+  virtual unsigned long updateSettings(TDEConfig *config) {
+    return d->updateKWinSettings(config);
+  }
+};
+
+static char harnessArg0[] = "q4win10_harness";
+static char *harnessArgv[] = {harnessArg0, 0};
+
+Harness::Harness(const char *name) {
+  // a settings and cache directory of our own, removed again when done
+  char dir[] = "/tmp/q4win10-harness-XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("q4win10: mkdtemp");
+    exit(2);
+  }
+  m_home = dir;
+  setenv("TDEHOME", dir, 1);
+  setenv("XDG_CACHE_HOME", dir, 1);
+
+  static TDEAboutData about(name, name, "1.0");
+  TDECmdLineArgs::init(1, harnessArgv, &about);
+  m_app = new TDEApplication();
+
+  m_options = new HarnessOptions;
+  m_handler = static_cast<Q4Win10Handler *>(create_factory());
+}
+
+Harness::~Harness() {
+  delete m_handler;
+  delete m_options;
+  delete m_app;
+  TQCString cmd = "rm -rf ";
+  cmd += m_home.latin1();
+  if (system(cmd.data()) != 0)
+    fprintf(stderr, "q4win10: could not remove %s\n", m_home.latin1());
+}
+
+Display *Harness::display() const { return tqt_xdisplay(); }
+
+void Harness::setConfig(const char *key, const TQString &value) {
+  TDEConfig config("twinq4win10rc");
+  config.setGroup("General");
+  config.writeEntry(key, value);
+  config.sync();
+  // a color change resets the tiles and all decorations without recreating
+  // them
+  m_handler->reset(KDecorationDefines::SettingColors);
+  flush();
+}
+
+void Harness::setDarkMode(bool dark) {
+  setConfig("DarkMode", dark ? "true" : "false");
+}
+
+Q4Win10Client *Harness::createClient(MockBridge *bridge) {
+  Q4Win10Client *client =
+      static_cast<Q4Win10Client *>(m_handler->createDecoration(bridge));
+  client->init();
+  client->widget()->move(0, 0);
+  client->resize(TQSize(bridge->state.width, bridge->state.height));
+  client->widget()->show();
+  flush();
+  return client;
+}
+
+void Harness::applyState(Q4Win10Client *client, MockBridge *bridge,
+                         const WindowState &old) {
+  const WindowState &s = bridge->state;
+  if (s.active != old.active)
+    client->activeChange();
+  if (s.maximized != old.maximized)
+    client->maximizeChange();
+  if (s.caption != old.caption)
+    client->captionChange();
+  if (s.width != old.width || s.height != old.height)
+    client->resize(TQSize(s.width, s.height));
+  // a tool window needs a new decoration, like in twin
+}
+
+void Harness::destroyClient(Q4Win10Client *client) {
+  delete client;
+  flush();
+}
+
+TQMemArray<Q4Win10Button *> Harness::buttons(Q4Win10Client *client) const {
+  TQMemArray<Q4Win10Button *> result;
+  const TQObjectList *children = client->widget()->children();
+  if (!children)
+    return result;
+  TQObjectListIt it(*children);
+  for (TQObject *o; (o = it.current()); ++it) {
+    if (!o->inherits("KWinQ4Win10::Q4Win10Button"))
+      continue;
+    result.resize(result.size() + 1);
+    result[result.size() - 1] = static_cast<Q4Win10Button *>(o);
+  }
+  return result;
+}
+
+unsigned long Harness::repaint(Q4Win10Client *client) {
+  const TQMemArray<Q4Win10Button *> b = buttons(client);
+  const unsigned long long start = nowNs();
+  client->widget()->repaint(false);
+  for (uint i = 0; i < b.size(); ++i)
+    b[i]->repaint(false);
+  XSync(display(), False);
+  return nowNs() - start;
+}
+
+TQImage Harness::grab(Q4Win10Client *client) {
+  XSync(display(), False);
+  // the window, not the widget, so the buttons are in it too
+  return TQPixmap::grabWindow(client->widget()->winId()).convertToImage();
+}
+
+void Harness::flush() {
+  // the idle caption renders and hover syncs run from zero timers
+  TQTime t;
+  t.start();
+  do {
+    XSync(display(), False);
+    m_app->processEvents(10);
+  } while (t.elapsed() < 20);
+}
+
+void Harness::poll() { m_app->processEvents(); }
+
+unsigned long long nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void Samples::add(unsigned long ns) {
+  m_ns.resize(m_ns.size() + 1);
+  m_ns[m_ns.size() - 1] = ns;
+}
+
+static int compareNs(const void *a, const void *b) {
+  const unsigned long x = *(const unsigned long *)a;
+  const unsigned long y = *(const unsigned long *)b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// sorts v in place
+static unsigned long median(TQMemArray<unsigned long> &v) {
+  const uint n = v.size();
+  if (n == 0)
+    return 0;
+  qsort(v.data(), n, sizeof(unsigned long), compareNs);
+  return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+unsigned long Samples::median() const {
+  TQMemArray<unsigned long> v = m_ns.copy();
+  return KWinQ4Win10::median(v);
+}
+
+unsigned long Samples::mad() const {
+  const unsigned long med = median();
+  TQMemArray<unsigned long> v = m_ns.copy();
+  for (uint i = 0; i < v.size(); ++i)
+    v[i] = v[i] > med ? v[i] - med : med - v[i];
+  return KWinQ4Win10::median(v);
+}
+
+unsigned long Samples::percentile(int pct) const {
+  const uint n = m_ns.size();
+  if (n == 0)
+    return 0;
+  TQMemArray<unsigned long> v = m_ns.copy();
+  qsort(v.data(), n, sizeof(unsigned long), compareNs);
+  const uint i = (n * pct + 99) / 100;
+  return v[i > 0 ? i - 1 : 0];
+}
+
+void writeSample(FILE *f, const TQString &name, const Samples &s, bool last) {
+  fprintf(f,
+          "  {\"name\": \"%s\", \"samples\": %u, \"median_ns\": %lu, "
+          "\"mad_ns\": %lu}%s\n",
+          name.latin1(), s.count(), s.median(), s.mad(), last ? "" : ",");
+}
+
+} // namespace KWinQ4Win10
@@ -0,0 +1,200 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef Q4WIN10HARNESS_H
+#define Q4WIN10HARNESS_H
+
+#include <kdecoration.h>
+#include <kdecoration_p.h>
+#include <tqiconset.h>
+#include <tqimage.h>
+#include <tqmemarray.h>
+#include <tqstring.h>
+
+#include <X11/Xlib.h>
+#include <stdio.h>
+
+#include "q4win10.h"
+
+class TDEApplication;
+
+namespace KWinQ4Win10 {
+
+class Q4Win10Button;
+class Q4Win10Client;
+
+// what a MockBridge tells its decoration about the window
+struct WindowState {
+  WindowState();
+
+  bool active;
+  bool toolWindow;
+  bool maximized;
+  TQString caption;
+  int width; // of the decoration
+  int height;
+  int x11Screen; // the decoration widget is created on, -1 = default
+};
+
+/**
+ * Stand-in for twin, modelled on the preview bridge of the twin control
+ * module. Decorations created on it are real Q4Win10Client instances on the
+ * harness display; only the window management side is faked. Every bridge
+ * owns an unmapped X window as its client window, so the property reads of
+ * the decoration have a target.
+ */
+class MockBridge : public KDecorationBridge {
+public:
+  MockBridge();
+  virtual ~MockBridge();
+
+  WindowState state;
+  TQIconSet windowIcon;
+
+  virtual bool isActive() const;
+  virtual bool isCloseable() const;
+  virtual bool isMaximizable() const;
+  virtual MaximizeMode maximizeMode() const;
+  virtual bool isMinimizable() const;
+  virtual bool providesContextHelp() const;
+  virtual int desktop() const;
+  virtual bool isModal() const;
+  virtual bool isShadeable() const;
+  virtual bool isShade() const;
+  virtual bool isSetShade() const;
+  virtual bool keepAbove() const;
+  virtual bool keepBelow() const;
+  virtual bool isMovable() const;
+  virtual bool isResizable() const;
+  virtual NET::WindowType windowType(unsigned long supported_types) const;
+  virtual TQIconSet icon() const;
+  virtual TQString caption() const;
+  virtual void processMousePressEvent(TQMouseEvent *);
+  virtual void showWindowMenu(const TQRect &);
+  virtual void showWindowMenu(TQPoint);
+  virtual void performWindowOperation(WindowOperation);
+  virtual void setMask(const TQRegion &, int);
+  virtual bool isPreview() const;
+  virtual TQRect geometry() const;
+  virtual TQRect iconGeometry() const;
+  virtual TQRegion unobscuredRegion(const TQRegion &r) const;
+  virtual TQWidget *workspaceWidget() const;
+  virtual WId windowId() const;
+  virtual void closeWindow();
+  virtual void maximize(MaximizeMode mode);
+  virtual void minimize();
+  virtual void showContextHelp();
+  virtual void setDesktop(int desktop);
+  virtual void titlebarDblClickOperation();
+  virtual void titlebarMouseWheelOperation(int delta);
+  virtual void setShade(bool set);
+  virtual void setKeepAbove(bool);
+  virtual void setKeepBelow(bool);
+  virtual int currentDesktop() const;
+  virtual TQWidget *initialParentWidget() const;
+  virtual TQt::WFlags initialWFlags() const;
+  virtual void helperShowHide(bool show);
+  virtual void grabXServer(bool grab);
+
+private:
+  Window m_window;
+};
+
+// the internals the harness needs, befriended by the decoration classes
+class HarnessAccess {
+public:
+  static void clearTileCache(Q4Win10Handler *handler);
+  static const TQPixmap &captionPixmap(Q4Win10Client *client, bool active);
+  static void clearCaptionPixmaps(Q4Win10Client *client);
+  // what the decoration does once a resize or focus change has settled
+  static void prerenderFrame(Q4Win10Client *client);
+  // captions queued for the next idle batch
+  static int pendingCaptions(Q4Win10Handler *handler);
+};
+
+/**
+ * The decoration plugin running without twin: a TDEApplication on the
+ * current display (normally Xvfb), decoration options with the built-in
+ * defaults and the handler. TDEHOME and XDG_CACHE_HOME point to a fresh
+ * directory, so neither the user's settings nor the icon cache on disk
+ * change the results.
+ */
+class Harness {
+public:
+  // the tools parse their own arguments, TDEApplication sees none
+  Harness(const char *name);
+  ~Harness();
+
+  Q4Win10Handler *handler() const { return m_handler; }
+  Display *display() const;
+
+  // writes the [General] group of twinq4win10rc and resets the handler
+  void setConfig(const char *key, const TQString &value);
+  void setDarkMode(bool dark);
+
+  // a decoration in bridge->state, shown at the top left of the screen
+  Q4Win10Client *createClient(MockBridge *bridge);
+  // tells the decoration what changed between old and bridge->state
+  void applyState(Q4Win10Client *client, MockBridge *bridge,
+                  const WindowState &old);
+  void destroyClient(Q4Win10Client *client);
+
+  // buttons in layout order
+  TQMemArray<Q4Win10Button *> buttons(Q4Win10Client *client) const;
+
+  // paints the frame and all buttons now, returns the nanoseconds taken
+  // until the server has processed the requests
+  unsigned long repaint(Q4Win10Client *client);
+  // the decoration as it is on screen
+  TQImage grab(Q4Win10Client *client);
+  // runs pending events for a moment, e.g. idle caption renders, and
+  // waits for the server
+  void flush();
+  // runs the events that are pending now, without waiting
+  void poll();
+
+private:
+  TDEApplication *m_app;
+  KDecorationOptions *m_options;
+  Q4Win10Handler *m_handler;
+  TQString m_home;
+};
+
+// monotonic clock
+unsigned long long nowNs();
+
+// repeated timings of one case, reported as median and MAD
+class Samples {
+public:
+  void add(unsigned long ns);
+  unsigned int count() const { return m_ns.size(); }
+  unsigned long median() const;
+  unsigned long mad() const;
+  // the smallest sample at or above pct percent of them, 100 = the largest
+  unsigned long percentile(int pct) const;
+
+private:
+  TQMemArray<unsigned long> m_ns;
+};
+
+// {"name": ..., "samples": n, "median_ns": m, "mad_ns": d}, one per line
+void writeSample(FILE *f, const TQString &name, const Samples &s, bool last);
+
+} // namespace KWinQ4Win10
+
+#endif // Q4WIN10HARNESS_H
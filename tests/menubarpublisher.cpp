@@ -0,0 +1,80 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#include "menubarpublisher.h"
+
+#include <X11/Xatom.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace KWinQ4Win10 {
+
+// the protocol version of MenuBarTable
+static const long TableVersion = 1;
+
+MenuBarPublisher::MenuBarPublisher() : m_display(XOpenDisplay(0)) {
+  if (!m_display) {
+    fprintf(stderr, "menubar publisher: cannot open the display\n");
+    exit(2);
+  }
+  m_tableAtom = XInternAtom(m_display, "_Q4WIN10_MENUBAR_HEIGHTS", False);
+  m_windowAtom = XInternAtom(m_display, "_Q4WIN10_MENUBAR_HEIGHT", False);
+}
+
+MenuBarPublisher::~MenuBarPublisher() {
+  withdraw();
+  XCloseDisplay(m_display);
+}
+
+void MenuBarPublisher::setHeight(WId window, int height) {
+  m_heights.replace(window, height);
+}
+
+void MenuBarPublisher::removeHeight(WId window) { m_heights.remove(window); }
+
+void MenuBarPublisher::publish() {
+  // format 32 properties are passed as longs by Xlib
+  const int n = m_heights.count();
+  long *data = new long[2 + 2 * n];
+  data[0] = TableVersion;
+  data[1] = n;
+  int i = 2;
+  TQMap<WId, int>::ConstIterator it;
+  for (it = m_heights.begin(); it != m_heights.end(); ++it) {
+    data[i++] = it.key();
+    data[i++] = it.data();
+  }
+  XChangeProperty(m_display, DefaultRootWindow(m_display), m_tableAtom,
+                  XA_CARDINAL, 32, PropModeReplace, (unsigned char *)data, i);
+  XSync(m_display, False);
+  delete[] data;
+}
+
+void MenuBarPublisher::withdraw() {
+  XDeleteProperty(m_display, DefaultRootWindow(m_display), m_tableAtom);
+  XSync(m_display, False);
+}
+
+void MenuBarPublisher::setWindowProperty(WId window, int height) {
+  long value = height;
+  XChangeProperty(m_display, window, m_windowAtom, XA_CARDINAL, 32,
+                  PropModeReplace, (unsigned char *)&value, 1);
+  XSync(m_display, False);
+}
+
+} // namespace KWinQ4Win10
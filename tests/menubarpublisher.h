@@ -0,0 +1,60 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+#ifndef Q4WIN10MENUBARPUBLISHER_H
+#define Q4WIN10MENUBARPUBLISHER_H
+
+#include <tqmap.h>
+#include <tqwindowdefs.h>
+
+#include <X11/Xlib.h>
+
+namespace KWinQ4Win10 {
+
+/**
+ * Stand-in for the Q4Win10 style: publishes menubar heights the way the
+ * style does (see MenuBarTable), from a connection of its own so the
+ * decoration sees the PropertyNotify events of another client.
+ */
+class MenuBarPublisher {
+public:
+  MenuBarPublisher();
+  ~MenuBarPublisher();
+
+  // entries of the root window table, written by publish()
+  void setHeight(WId window, int height);
+  void removeHeight(WId window);
+
+  // writes _Q4WIN10_MENUBAR_HEIGHTS on the root window
+  void publish();
+  // deletes the table, the decoration falls back to the window properties
+  void withdraw();
+
+  // the per-window _Q4WIN10_MENUBAR_HEIGHT of an older style
+  void setWindowProperty(WId window, int height);
+
+private:
+  Display *m_display;
+  Atom m_tableAtom;
+  Atom m_windowAtom;
+  TQMap<WId, int> m_heights;
+};
+
+} // namespace KWinQ4Win10
+
+#endif // Q4WIN10MENUBARPUBLISHER_H
@@ -0,0 +1,178 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Menubar heights pushed through the root window table: after each update
+ * of the table only the clients whose entry changed may be told about it,
+ * and when the table goes away every client falls back to its window
+ * property. Needs an X display, e.g. Xvfb.
+ *
+ * The pushes are taken from an event log (see Recorder), setMenuBarHeight()
+ * records every call.
+ */
+
+#include <tqmap.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../q4win10client.h"
+#include "../q4win10record.h"
+#include "harness.h"
+#include "menubarpublisher.h"
+
+using namespace KWinQ4Win10;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #cond);        \
+      ++failures;                                                              \
+    }                                                                          \
+  } while (0)
+
+static char logPath[] = "/tmp/q4win10-menubar-XXXXXX";
+
+// starts a fresh log of the pushes
+static void startLog() {
+  Recorder::shutdown();
+  setenv("Q4WIN10_RECORD", logPath, 1);
+  Recorder::init();
+}
+
+// the heights pushed per window since startLog(), -1 = none; a window
+// pushed twice counts as a failure
+static TQMap<WId, int> pushes() {
+  Recorder::shutdown();
+  TQMap<WId, int> result;
+  RecordReader reader;
+  if (!reader.open(logPath)) {
+    fprintf(stderr, "cannot read %s\n", logPath);
+    ++failures;
+    return result;
+  }
+  RecordEvent e;
+  while (reader.next(e)) {
+    if (e.type != RecMenuBar)
+      continue;
+    CHECK(!result.contains(e.window));
+    result.replace(e.window, e.a);
+  }
+  return result;
+}
+
+static int pushed(const TQMap<WId, int> &p, MockBridge &bridge) {
+  TQMap<WId, int>::ConstIterator it = p.find(bridge.windowId());
+  return it != p.end() ? it.data() : -1;
+}
+
+int main() {
+  const int fd = mkstemp(logPath);
+  if (fd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+  close(fd);
+
+  MenuBarPublisher publisher;
+  publisher.withdraw();
+
+  Harness harness("q4win10_menubartest");
+  MockBridge a, b, c;
+  Q4Win10Client *clientA = harness.createClient(&a);
+  Q4Win10Client *clientB = harness.createClient(&b);
+  Q4Win10Client *clientC = harness.createClient(&c);
+  TQMap<WId, int> p;
+
+  // the first table replaces the window properties, every client is told
+  startLog();
+  publisher.setHeight(a.windowId(), 22);
+  publisher.setHeight(b.windowId(), 30);
+  publisher.publish();
+  harness.flush();
+  p = pushes();
+  CHECK(pushed(p, a) == 22);
+  CHECK(pushed(p, b) == 30);
+  CHECK(pushed(p, c) == 0);
+
+  // one entry changes
+  startLog();
+  publisher.setHeight(b.windowId(), 24);
+  publisher.publish();
+  harness.flush();
+  p = pushes();
+  CHECK(pushed(p, a) == -1);
+  CHECK(pushed(p, b) == 24);
+  CHECK(pushed(p, c) == -1);
+
+  // an entry is added, an unrelated one is dropped
+  startLog();
+  publisher.setHeight(c.windowId(), 18);
+  publisher.removeHeight(a.windowId());
+  publisher.publish();
+  harness.flush();
+  p = pushes();
+  CHECK(pushed(p, a) == 0);
+  CHECK(pushed(p, b) == -1);
+  CHECK(pushed(p, c) == 18);
+
+  // the same table again: nobody is told
+  startLog();
+  publisher.publish();
+  harness.flush();
+  p = pushes();
+  CHECK(p.isEmpty());
+
+  // no table: every client whose height differs from its window property
+  startLog();
+  publisher.setWindowProperty(b.windowId(), 24);
+  publisher.withdraw();
+  harness.flush();
+  p = pushes();
+  CHECK(pushed(p, a) == -1);
+  CHECK(pushed(p, b) == -1);
+  CHECK(pushed(p, c) == 0);
+
+  // an older style sets the window property, only that client repaints
+  startLog();
+  publisher.setWindowProperty(a.windowId(), 20);
+  harness.flush();
+  harness.repaint(clientA);
+  harness.repaint(clientB);
+  harness.repaint(clientC);
+  p = pushes();
+  CHECK(pushed(p, a) == 20);
+  CHECK(pushed(p, b) == -1);
+  CHECK(pushed(p, c) == -1);
+
+  harness.destroyClient(clientA);
+  harness.destroyClient(clientB);
+  harness.destroyClient(clientC);
+  unlink(logPath);
+
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  printf("menubar table OK\n");
+  return 0;
+}
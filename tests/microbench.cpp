@@ -0,0 +1,609 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Microbenchmarks of the decoration's hot functions, without twin.
+ *
+ *   q4win10_microbench [--reps N] [--warmup N] [--filter TEXT]
+ *                      [--output FILE] [--compare BASELINE] [--threshold PCT]
+ *
+ * Every case runs its warmup repetitions first, then N timed ones; the
+ * median and the median absolute deviation per call go to FILE as JSON
+ * (stdout if unset). With --compare the results are checked against an
+ * earlier output: a case regressed when its median grew by more than PCT
+ * percent (10 by default) and by more than three baseline MADs, the exit
+ * status is 1 then.
+ */
+
+#include <tqapplication.h>
+#include <tqevent.h>
+#include <tqstring.h>
+#include <tqvaluelist.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../q4win10button.h"
+#include "../q4win10client.h"
+#include "../q4win10iconcache.h"
+#include "harness.h"
+
+using namespace KWinQ4Win10;
+
+// one benchmark case, run() is timed, prepare() is not
+class BenchCase {
+public:
+  BenchCase() : batch(1), server(false) {}
+  virtual ~BenchCase() {}
+  virtual void prepare() {}
+  virtual void run() = 0;
+
+  int batch;   // calls per timed repetition, for functions below a microsecond
+  bool server; // waits for the X server at the end of the repetition
+};
+
+struct Result {
+  Result() : tail(false) {}
+  TQString name;
+  Samples samples;
+  bool tail;      // also write the 99th percentile and the maximum
+  Samples totals; // per round of a burst
+};
+
+static int reps = 50;
+static int warmup = 5;
+static const char *filter = 0;
+static TQValueList<Result> results;
+static volatile int sink; // keeps results of pure functions alive
+
+static void measure(const TQString &name, BenchCase &c) {
+  if (filter && !strstr(name.latin1(), filter))
+    return;
+  Result r;
+  r.name = name;
+  for (int i = -warmup; i < reps; ++i) {
+    c.prepare();
+    XSync(tqt_xdisplay(), False);
+    const unsigned long long start = nowNs();
+    for (int b = 0; b < c.batch; ++b)
+      c.run();
+    if (c.server)
+      XSync(tqt_xdisplay(), False);
+    if (i >= 0)
+      r.samples.add((nowNs() - start) / c.batch);
+  }
+  results.append(r);
+}
+
+class IconCase : public BenchCase {
+public:
+  IconCase(ButtonIcon icon, int size) : m_icon(icon), m_size(size) {
+    server = true;
+  }
+  virtual void run() { IconEngine::icon(m_icon, m_size); }
+
+private:
+  ButtonIcon m_icon;
+  int m_size;
+};
+
+// a tile built from scratch, or taken from the cache
+class PixmapCase : public BenchCase {
+public:
+  PixmapCase(Q4Win10Handler *handler, Pixmaps type, bool active, bool tool,
+             bool cold)
+      : m_handler(handler), m_type(type), m_active(active), m_tool(tool),
+        m_cold(cold) {
+    server = cold;
+    batch = cold ? 1 : 10000;
+  }
+  virtual void prepare() {
+    if (m_cold)
+      HarnessAccess::clearTileCache(m_handler);
+    else
+      m_handler->pixmap(m_type, m_active, m_tool, m_variant);
+  }
+  virtual void run() {
+    sink += m_handler->pixmap(m_type, m_active, m_tool, m_variant).width();
+  }
+
+private:
+  Q4Win10Handler *m_handler;
+  Pixmaps m_type;
+  bool m_active;
+  bool m_tool;
+  bool m_cold;
+  TileVariant m_variant;
+};
+
+class BitmapCase : public BenchCase {
+public:
+  BitmapCase(Q4Win10Handler *handler, ButtonIcon icon, int size)
+      : m_handler(handler), m_icon(icon), m_size(size, size) {
+    server = true;
+  }
+  virtual void prepare() { HarnessAccess::clearTileCache(m_handler); }
+  virtual void run() {
+    m_handler->buttonBitmap(m_icon, m_size, false, m_variant);
+  }
+
+private:
+  Q4Win10Handler *m_handler;
+  ButtonIcon m_icon;
+  TQSize m_size;
+  TileVariant m_variant;
+};
+
+class CaptionCase : public BenchCase {
+public:
+  CaptionCase(Q4Win10Client *client, bool active)
+      : m_client(client), m_active(active) {
+    server = true;
+  }
+  virtual void prepare() { HarnessAccess::clearCaptionPixmaps(m_client); }
+  virtual void run() { HarnessAccess::captionPixmap(m_client, m_active); }
+
+private:
+  Q4Win10Client *m_client;
+  bool m_active;
+};
+
+// the menu button icon of a window: cold reads the unscaled icon back from
+// the server, scales it and writes a new entry, warm loads the entry
+class IconCacheCase : public BenchCase {
+public:
+  IconCacheCase(Q4Win10Handler *handler, bool cold)
+      : m_cache(handler->iconCache()), m_source(48, 48), m_cold(cold),
+        m_runs(0) {
+    server = true;
+    m_source.fill(TQColor(0, 120, 215));
+    if (!cold)
+      m_cache->scaledIcon(0, "Bench-00000000", m_source, 16);
+  }
+  virtual void run() {
+    // a cold run is an icon the cache has not seen
+    TQCString key = "Bench-00000000";
+    if (m_cold)
+      key.sprintf("Bench-%08x", ++m_runs);
+    sink += m_cache->scaledIcon(0, key, m_source, 16).width();
+  }
+
+private:
+  IconCache *m_cache;
+  TQPixmap m_source;
+  bool m_cold;
+  unsigned int m_runs;
+};
+
+// an interactive resize in steps of 8 pixels: a resize and a repaint per
+// step with the events in between, the work done once the resize has
+// settled counts towards the last step
+class ResizeCase : public BenchCase {
+public:
+  ResizeCase(Harness &harness, Q4Win10Client *client, MockBridge *bridge,
+             int from, int to)
+      : m_harness(harness), m_client(client), m_bridge(bridge), m_from(from),
+        m_to(to), m_step(0) {
+    server = true;
+    batch = TQABS(to - from) / 8;
+  }
+  virtual void prepare() {
+    resizeTo(m_from);
+    HarnessAccess::prerenderFrame(m_client);
+    m_step = 0;
+  }
+  virtual void run() {
+    ++m_step;
+    resizeTo(m_from + (m_to - m_from) * m_step / batch);
+    m_harness.poll();
+    if (m_step == batch)
+      HarnessAccess::prerenderFrame(m_client);
+  }
+
+private:
+  void resizeTo(int width) {
+    const WindowState old = m_bridge->state;
+    m_bridge->state.width = width;
+    m_harness.applyState(m_client, m_bridge, old);
+    m_client->widget()->repaint(false);
+  }
+
+  Harness &m_harness;
+  Q4Win10Client *m_client;
+  MockBridge *m_bridge;
+  int m_from;
+  int m_to;
+  int m_step;
+};
+
+class LayoutCase : public BenchCase {
+public:
+  LayoutCase(Q4Win10Client *client, KCommonDecoration::LayoutMetric lm)
+      : m_client(client), m_lm(lm) {
+    batch = 10000;
+  }
+  virtual void run() { sink += m_client->layoutMetric(m_lm); }
+
+private:
+  Q4Win10Client *m_client;
+  KCommonDecoration::LayoutMetric m_lm;
+};
+
+class HsvCase : public BenchCase {
+public:
+  HsvCase() : m_color(0, 120, 215) { batch = 10000; }
+  virtual void run() { sink += hsvRelative(m_color, 0, -20, 30).rgb(); }
+
+private:
+  TQColor m_color;
+};
+
+class BlendCase : public BenchCase {
+public:
+  BlendCase() : m_bg(0, 120, 215), m_fg(255, 255, 255) { batch = 10000; }
+  virtual void run() { sink += alphaBlendColors(m_bg, m_fg, 96).rgb(); }
+
+private:
+  TQColor m_bg;
+  TQColor m_fg;
+};
+
+// fires whenever the event loop gets to its timers; a gap between two beats
+// is a stretch of event handling nothing else could get in between
+class Heartbeat : public TQObject {
+public:
+  Heartbeat() : m_gaps(0), m_last(0) { startTimer(0); }
+  // the gaps from now on go to gaps, 0 = nowhere
+  void restart(Samples *gaps) {
+    m_gaps = gaps;
+    m_last = nowNs();
+  }
+
+protected:
+  virtual void timerEvent(TQTimerEvent *) {
+    const unsigned long long now = nowNs();
+    if (m_gaps)
+      m_gaps->add(now - m_last);
+    m_last = now;
+  }
+
+private:
+  Samples *m_gaps;
+  unsigned long long m_last;
+};
+
+// retitles as posted events: the event loop delivers all of them in one go,
+// like a queue of PropertyNotify events
+class RetitleDispatcher : public TQObject {
+public:
+  RetitleDispatcher(Harness &harness, Q4Win10Client **clients,
+                    MockBridge **bridges)
+      : round(0), delivered(0), m_harness(harness), m_clients(clients),
+        m_bridges(bridges) {}
+
+  int round;
+  int delivered;
+
+protected:
+  virtual void customEvent(TQCustomEvent *e) {
+    const long i = (long)e->data();
+    const WindowState old = m_bridges[i]->state;
+    m_bridges[i]->state.caption =
+        TQString("win %1 - update %2").arg(i).arg(round);
+    m_harness.applyState(m_clients[i], m_bridges[i], old);
+    ++delivered;
+  }
+
+private:
+  Harness &m_harness;
+  Q4Win10Client **m_clients;
+  MockBridge **m_bridges;
+};
+
+static const int BurstWindows = 1000;
+static const int BurstRounds = 5;
+
+// every window retitled at once (a wall of terminals or a dashboard), with
+// the captions rendered in idle batches and in the event handler: the gaps
+// of a heartbeat timer are how long other events had to wait
+static void retitleBurst(Harness &harness) {
+  if (filter && !strstr("retitleBurst", filter))
+    return;
+
+  Q4Win10Client **clients = new Q4Win10Client *[BurstWindows];
+  MockBridge **bridges = new MockBridge *[BurstWindows];
+  for (int i = 0; i < BurstWindows; ++i) {
+    bridges[i] = new MockBridge;
+    bridges[i]->state.width = 300;
+    bridges[i]->state.height = 200;
+    bridges[i]->state.active = false;
+    clients[i] = harness.createClient(bridges[i]);
+  }
+  RetitleDispatcher dispatcher(harness, clients, bridges);
+  Heartbeat beat;
+  harness.setConfig("MaxCaptionRate", "0");
+
+  for (int batched = 1; batched >= 0; --batched) {
+    harness.setConfig("CaptionBudget", batched ? "8" : "0");
+    // the new caption of a window without a caption pixmap is always
+    // rendered right away, let them all have one
+    for (int i = 0; i < BurstWindows; ++i)
+      harness.repaint(clients[i]);
+    harness.flush();
+
+    Result r;
+    r.name = TQString("retitleBurst/%1/%2")
+                 .arg(BurstWindows)
+                 .arg(batched ? "batched" : "unbatched");
+    r.tail = true;
+    for (int round = 0; round < BurstRounds; ++round) {
+      dispatcher.round = round;
+      dispatcher.delivered = 0;
+      for (long i = 0; i < BurstWindows; ++i)
+        TQApplication::postEvent(&dispatcher,
+                                 new TQCustomEvent(TQEvent::User, (void *)i));
+      beat.restart(&r.samples);
+      const unsigned long long start = nowNs();
+      while (dispatcher.delivered < BurstWindows ||
+             HarnessAccess::pendingCaptions(harness.handler()) > 0)
+        harness.poll();
+      r.totals.add(nowNs() - start);
+      // the gap that ends with the last render
+      harness.poll();
+      beat.restart(0);
+      harness.flush();
+    }
+    results.append(r);
+  }
+
+  harness.setConfig("CaptionBudget", "8");
+  for (int i = 0; i < BurstWindows; ++i) {
+    harness.destroyClient(clients[i]);
+    delete bridges[i];
+  }
+  delete[] clients;
+  delete[] bridges;
+}
+
+static const char *const iconNames[NumButtonIcons] = {
+    "close",       "max",           "maxRestore",       "min",
+    "help",        "onAllDesktops", "notOnAllDesktops", "keepAbove",
+    "noKeepAbove", "keepBelow",     "noKeepBelow",      "shade",
+    "unShade"};
+
+static const char *const pixmapNames[NumPixmaps] = {
+    "TitleBarTileTop", "TitleBarTile",     "TitleBarLeft",
+    "TitleBarRight",   "BorderLeftTile",   "BorderRightTile",
+    "BorderBottomTile", "BorderBottomLeft", "BorderBottomRight"};
+
+static const struct {
+  KCommonDecoration::LayoutMetric lm;
+  const char *name;
+} layoutMetrics[] = {
+    {KCommonDecoration::LM_BorderLeft, "BorderLeft"},
+    {KCommonDecoration::LM_BorderRight, "BorderRight"},
+    {KCommonDecoration::LM_BorderBottom, "BorderBottom"},
+    {KCommonDecoration::LM_TitleHeight, "TitleHeight"},
+    {KCommonDecoration::LM_TitleBorderLeft, "TitleBorderLeft"},
+    {KCommonDecoration::LM_TitleBorderRight, "TitleBorderRight"},
+    {KCommonDecoration::LM_TitleEdgeLeft, "TitleEdgeLeft"},
+    {KCommonDecoration::LM_TitleEdgeRight, "TitleEdgeRight"},
+    {KCommonDecoration::LM_TitleEdgeTop, "TitleEdgeTop"},
+    {KCommonDecoration::LM_TitleEdgeBottom, "TitleEdgeBottom"},
+    {KCommonDecoration::LM_ButtonWidth, "ButtonWidth"},
+    {KCommonDecoration::LM_ButtonHeight, "ButtonHeight"},
+    {KCommonDecoration::LM_ButtonSpacing, "ButtonSpacing"},
+    {KCommonDecoration::LM_ExplicitButtonSpacer, "ExplicitButtonSpacer"},
+    {KCommonDecoration::LM_ButtonMarginTop, "ButtonMarginTop"}};
+
+// button icon sizes of the default title heights at scale 1 to 3
+static const int iconSizes[] = {10, 20, 30};
+
+static void runCases(Harness &harness) {
+  Q4Win10Handler *handler = harness.handler();
+
+  for (int i = 0; i < NumButtonIcons; ++i)
+    for (uint s = 0; s < sizeof(iconSizes) / sizeof(iconSizes[0]); ++s) {
+      IconCase c((ButtonIcon)i, iconSizes[s]);
+      measure(TQString("IconEngine::icon/%1/%2")
+                  .arg(iconNames[i])
+                  .arg(iconSizes[s]),
+              c);
+    }
+
+  for (int p = 0; p < NumPixmaps; ++p)
+    for (int tool = 0; tool < 2; ++tool)
+      for (int active = 0; active < 2; ++active)
+        for (int cold = 0; cold < 2; ++cold) {
+          PixmapCase c(handler, (Pixmaps)p, active, tool, cold);
+          measure(TQString("pixmap/%1/%2/%3/%4")
+                      .arg(pixmapNames[p])
+                      .arg(active ? "active" : "inactive")
+                      .arg(tool ? "tool" : "normal")
+                      .arg(cold ? "cold" : "cached"),
+                  c);
+        }
+
+  for (int i = 0; i < NumButtonIcons; ++i) {
+    BitmapCase c(handler, (ButtonIcon)i, iconSizes[0]);
+    measure(TQString("buttonBitmap/%1").arg(iconNames[i]), c);
+  }
+
+  for (int cold = 0; cold < 2; ++cold) {
+    IconCacheCase c(handler, cold);
+    measure(TQString("scaledIcon/%1").arg(cold ? "cold" : "warm"), c);
+  }
+
+  MockBridge bridge;
+  Q4Win10Client *client = harness.createClient(&bridge);
+
+  const char *const titles[2] = {
+      "Editor",
+      "Quarterly report (final, reviewed) - Sales figures for all regions "
+      "with the corrections from the last meeting - Spreadsheet Editor"};
+  for (int t = 0; t < 2; ++t) {
+    bridge.state.caption = titles[t];
+    for (int active = 0; active < 2; ++active) {
+      CaptionCase c(client, active);
+      measure(TQString("captionPixmap/%1/%2")
+                  .arg(t ? "long" : "short")
+                  .arg(active ? "active" : "inactive"),
+              c);
+    }
+  }
+
+  // per step, see ResizeCase
+  ResizeCase grow(harness, client, &bridge, 400, 1600);
+  measure("resize/grow", grow);
+  ResizeCase shrink(harness, client, &bridge, 1600, 400);
+  measure("resize/shrink", shrink);
+
+  for (uint i = 0; i < sizeof(layoutMetrics) / sizeof(layoutMetrics[0]);
+       ++i) {
+    LayoutCase c(client, layoutMetrics[i].lm);
+    measure(TQString("layoutMetric/%1").arg(layoutMetrics[i].name), c);
+  }
+
+  harness.destroyClient(client);
+
+  HsvCase hsv;
+  measure("hsvRelative", hsv);
+  BlendCase blend;
+  measure("alphaBlendColors", blend);
+
+  retitleBurst(harness);
+}
+
+static void writeResults(FILE *f) {
+  fprintf(f, "{\"q4win10_microbench\": [\n");
+  TQValueList<Result>::ConstIterator it = results.begin();
+  while (it != results.end()) {
+    const Result &r = *it;
+    ++it;
+    if (!r.tail) {
+      writeSample(f, r.name, r.samples, it == results.end());
+      continue;
+    }
+    fprintf(f,
+            "  {\"name\": \"%s\", \"samples\": %u, \"median_ns\": %lu, "
+            "\"mad_ns\": %lu, \"p99_ns\": %lu, \"max_ns\": %lu, "
+            "\"total_ns\": %lu}%s\n",
+            r.name.latin1(), r.samples.count(), r.samples.median(),
+            r.samples.mad(), r.samples.percentile(99),
+            r.samples.percentile(100), r.totals.median(),
+            it == results.end() ? "" : ",");
+  }
+  fprintf(f, "]}\n");
+}
+
+// reads the median and MAD of a case from a results file, one case per line
+static bool baselineOf(FILE *f, const TQString &name, unsigned long &median,
+                       unsigned long &mad) {
+  TQCString key = "{\"name\": \"";
+  key += name.latin1();
+  key += "\",";
+  rewind(f);
+  char line[1024];
+  while (fgets(line, sizeof(line), f)) {
+    const char *p = strstr(line, key.data());
+    if (!p)
+      continue;
+    const char *m = strstr(p, "\"median_ns\": ");
+    const char *d = strstr(p, "\"mad_ns\": ");
+    if (!m || !d)
+      return false;
+    median = strtoul(m + 13, 0, 10);
+    mad = strtoul(d + 10, 0, 10);
+    return true;
+  }
+  return false;
+}
+
+static int compare(const char *path, int threshold) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return 2;
+  }
+  int regressions = 0;
+  TQValueList<Result>::ConstIterator it;
+  for (it = results.begin(); it != results.end(); ++it) {
+    unsigned long base, baseMad;
+    if (!baselineOf(f, (*it).name, base, baseMad)) {
+      fprintf(stderr, "%s: not in the baseline\n", (*it).name.latin1());
+      continue;
+    }
+    const unsigned long now = (*it).samples.median();
+    if (now * 100 > base * (100 + threshold) && now - base > 3 * baseMad) {
+      fprintf(stderr, "%s: %lu ns, was %lu ns (+%lu%%)\n", (*it).name.latin1(),
+              now, base, base ? (now - base) * 100 / base : 0);
+      ++regressions;
+    }
+  }
+  fclose(f);
+  fprintf(stderr, "%d of %u cases regressed\n", regressions, results.count());
+  return regressions ? 1 : 0;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: q4win10_microbench [--reps N] [--warmup N] [--filter TEXT]\n"
+          "       [--output FILE] [--compare BASELINE] [--threshold PCT]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *output = 0;
+  const char *baseline = 0;
+  int threshold = 10;
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc)
+      usage();
+    if (!strcmp(argv[i], "--reps"))
+      reps = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--warmup"))
+      warmup = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--filter"))
+      filter = argv[++i];
+    else if (!strcmp(argv[i], "--output"))
+      output = argv[++i];
+    else if (!strcmp(argv[i], "--compare"))
+      baseline = argv[++i];
+    else if (!strcmp(argv[i], "--threshold"))
+      threshold = atoi(argv[++i]);
+    else
+      usage();
+  }
+  if (reps < 1 || warmup < 0)
+    usage();
+
+  Harness harness("q4win10_microbench");
+  runCases(harness);
+
+  FILE *f = output ? fopen(output, "w") : stdout;
+  if (!f) {
+    perror(output);
+    return 2;
+  }
+  writeResults(f);
+  if (f != stdout)
+    fclose(f);
+
+  return baseline ? compare(baseline, threshold) : 0;
+}
@@ -0,0 +1,142 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Round trip of the event log: records written by Recorder must come back
+ * unchanged from RecordReader, a truncated log must end cleanly and a file
+ * that is no log must be refused. Needs no X display.
+ */
+
+#include <tqcstring.h>
+#include <tqstring.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../q4win10record.h"
+
+using namespace KWinQ4Win10;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #cond);        \
+      ++failures;                                                              \
+    }                                                                          \
+  } while (0)
+
+struct Expected {
+  RecordType type;
+  unsigned long window;
+  int a, b, c, d;
+  const char *caption; // UTF-8
+};
+
+static const Expected expected[] = {
+    {RecCreate, 0x1400007, 0, 0, 0, 0, 0},
+    {RecCaption, 0x1400007, 0, 0, 0, 0, "Document - Editor"},
+    {RecGeometry, 0x1400007, 640, 480, 0, 0, 0},
+    {RecActive, 0x1400007, 1, 0, 0, 0, 0},
+    {RecExpose, 0x1400007, 0, 0, 640, 30, 0},
+    {RecExpose, 0x1400007, -4, 26, 4, 454, 0},
+    {RecMenuBar, 0x1400007, 22, 0, 0, 0, 0},
+    {RecCaption, 0x1600003, 0, 0, 0, 0,
+     "Gr\xc3\xbc\xc3\x9f\x65 \xe2\x80\x93 Caf\xc3\xa9"},
+    {RecMaximize, 0x1400007, 3, 0, 0, 0, 0},
+    {RecCaption, 0x1400007, 0, 0, 0, 0, ""},
+    {RecReset, 0x1400007, 0x7fffffff, 0, 0, 0, 0},
+    {RecDestroy, 0x1400007, 0, 0, 0, 0, 0}};
+static const int NumExpected = sizeof(expected) / sizeof(expected[0]);
+
+static void writeLog(const char *path) {
+  setenv("Q4WIN10_RECORD", path, 1);
+  Recorder::init();
+  CHECK(Recorder::enabled());
+  for (int i = 0; i < NumExpected; ++i) {
+    const Expected &x = expected[i];
+    if (x.caption)
+      Recorder::recordCaption(x.window, TQString::fromUtf8(x.caption));
+    else
+      Recorder::record(x.type, x.window, x.a, x.b, x.c, x.d);
+  }
+  Recorder::shutdown();
+  CHECK(!Recorder::enabled());
+}
+
+// reads the log back, returns the number of records that matched
+static int readLog(const char *path) {
+  RecordReader reader;
+  CHECK(reader.open(path));
+  RecordEvent e;
+  int n = 0;
+  while (reader.next(e)) {
+    CHECK(n < NumExpected);
+    if (n >= NumExpected)
+      break;
+    const Expected &x = expected[n];
+    CHECK(e.type == x.type);
+    CHECK(e.window == x.window);
+    if (x.caption) {
+      // a null TQString does not compare equal to an empty one
+      const TQCString utf8 = e.caption.utf8();
+      CHECK(!strcmp(utf8.data() ? utf8.data() : "", x.caption));
+    } else {
+      CHECK(e.a == x.a && e.b == x.b && e.c == x.c && e.d == x.d);
+      CHECK(e.caption.isEmpty());
+    }
+    ++n;
+  }
+  return n;
+}
+
+int main() {
+  char path[] = "/tmp/q4win10-record-XXXXXX";
+  const int fd = mkstemp(path);
+  if (fd < 0) {
+    perror("mkstemp");
+    return 2;
+  }
+  close(fd);
+
+  writeLog(path);
+  CHECK(readLog(path) == NumExpected);
+
+  // a log cut off in the last record, e.g. twin was killed
+  FILE *f = fopen(path, "rb");
+  fseek(f, 0, SEEK_END);
+  const long size = ftell(f);
+  fclose(f);
+  CHECK(truncate(path, size - 3) == 0);
+  CHECK(readLog(path) == NumExpected - 1);
+
+  // not a log
+  f = fopen(path, "wb");
+  fputs("Q4WI not a recording", f);
+  fclose(f);
+  RecordReader reader;
+  CHECK(!reader.open(path));
+
+  unlink(path);
+  if (failures)
+    fprintf(stderr, "%d checks failed\n", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,203 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Feeds a log written with $Q4WIN10_RECORD back into decorations on the
+ * harness display.
+ *
+ *   q4win10_replay [--realtime] [--reps N] [--output FILE] LOG
+ *
+ * Every window of the log gets a Q4Win10Client on a MockBridge; captions,
+ * activation, geometry, maximize, menubar and reset records are applied
+ * like twin would, exposes repaint the recorded rectangle. By default the
+ * log runs at full speed, --realtime keeps the recorded gaps so idle work
+ * (deferred captions, throttling) happens as in the session. The handling
+ * time of each record type, until the server has processed the requests,
+ * goes to FILE as JSON (stdout if unset); --reps replays the log N times.
+ */
+
+#include <tqmap.h>
+#include <tqrect.h>
+#include <tqstring.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../q4win10client.h"
+#include "../q4win10record.h"
+#include "harness.h"
+
+using namespace KWinQ4Win10;
+
+static const char *const typeNames[] = {
+    "",        "create",   "destroy", "caption", "active",
+    "geometry", "maximize", "menubar", "reset",   "expose"};
+static const int NumTypes = sizeof(typeNames) / sizeof(typeNames[0]);
+
+struct Replayed {
+  Replayed() : bridge(0), client(0) {}
+  MockBridge *bridge;
+  Q4Win10Client *client;
+};
+
+static Harness *harness;
+static TQMap<unsigned long, Replayed> windows;
+static Samples samples[NumTypes];
+
+// windows that existed before the recording started appear mid-stream
+static Replayed &window(unsigned long id) {
+  Replayed &w = windows[id];
+  if (!w.client) {
+    w.bridge = new MockBridge;
+    w.client = harness->createClient(w.bridge);
+  }
+  return w;
+}
+
+static void destroy(unsigned long id) {
+  TQMap<unsigned long, Replayed>::Iterator it = windows.find(id);
+  if (it == windows.end())
+    return;
+  harness->destroyClient(it.data().client);
+  delete it.data().bridge;
+  windows.remove(it);
+}
+
+static void apply(const RecordEvent &e) {
+  if (e.type == RecDestroy) {
+    destroy(e.window);
+    return;
+  }
+  Replayed &w = window(e.window);
+  const WindowState old = w.bridge->state;
+  WindowState &s = w.bridge->state;
+
+  switch (e.type) {
+  case RecCaption:
+    s.caption = e.caption;
+    break;
+  case RecActive:
+    s.active = e.a;
+    break;
+  case RecGeometry:
+    s.width = e.a;
+    s.height = e.b;
+    break;
+  case RecMaximize:
+    s.maximized = e.a == KDecorationDefines::MaximizeFull;
+    break;
+  case RecMenuBar:
+    w.client->setMenuBarHeight(e.a);
+    break;
+  case RecReset:
+    w.client->reset(e.a);
+    break;
+  case RecExpose:
+    w.client->widget()->repaint(TQRect(e.a, e.b, e.c, e.d), false);
+    break;
+  default:
+    break;
+  }
+  harness->applyState(w.client, w.bridge, old);
+}
+
+static bool replay(const char *path, bool realtime) {
+  RecordReader reader;
+  if (!reader.open(path)) {
+    fprintf(stderr, "%s: not a q4win10 recording\n", path);
+    return false;
+  }
+
+  RecordEvent e;
+  unsigned long long due = nowNs();
+  while (reader.next(e)) {
+    if (realtime) {
+      due += e.time * 1000ULL;
+      // idle work runs in the recorded gaps, like in the session
+      for (unsigned long long t = nowNs(); t < due; t = nowNs()) {
+        harness->poll();
+        const unsigned long long left = (due - t) / 1000;
+        usleep(left < 1000 ? left : 1000);
+      }
+    }
+
+    const unsigned long long start = nowNs();
+    apply(e);
+    XSync(harness->display(), False);
+    if (e.type > 0 && e.type < NumTypes)
+      samples[e.type].add(nowNs() - start);
+
+    if (!realtime)
+      harness->poll();
+  }
+
+  while (!windows.isEmpty())
+    destroy(windows.begin().key());
+  return true;
+}
+
+static void usage() {
+  fprintf(stderr, "usage: q4win10_replay [--realtime] [--reps N] "
+                  "[--output FILE] LOG\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  bool realtime = false;
+  int reps = 1;
+  const char *output = 0;
+  const char *path = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--realtime"))
+      realtime = true;
+    else if (!strcmp(argv[i], "--reps") && i + 1 < argc)
+      reps = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--output") && i + 1 < argc)
+      output = argv[++i];
+    else if (argv[i][0] != '-' && !path)
+      path = argv[i];
+    else
+      usage();
+  }
+  if (!path || reps < 1)
+    usage();
+
+  Harness h("q4win10_replay");
+  harness = &h;
+
+  const unsigned long long start = nowNs();
+  for (int i = 0; i < reps; ++i)
+    if (!replay(path, realtime))
+      return 2;
+  const unsigned long long total = nowNs() - start;
+
+  FILE *f = output ? fopen(output, "w") : stdout;
+  if (!f) {
+    perror(output);
+    return 2;
+  }
+  fprintf(f, "{\"q4win10_replay\": [\n");
+  for (int t = 1; t < NumTypes; ++t)
+    writeSample(f, typeNames[t], samples[t], t + 1 == NumTypes);
+  fprintf(f, "], \"total_ns\": %llu}\n", total);
+  if (f != stdout)
+    fclose(f);
+  return 0;
+}
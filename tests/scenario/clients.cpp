@@ -0,0 +1,144 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * The windows of the scenario run, see run.sh.
+ *
+ *   q4win10_clients N
+ *
+ * Maps N top-level windows from one connection, each with a title, an
+ * application icon and a _Q4WIN10_MENUBAR_HEIGHT, and prints "ready" once
+ * the server has them. Every SIGUSR1 retitles all of them once (title
+ * churn); SIGTERM ends the program. Plain Xlib, so the clients cost twin
+ * the same as real applications but nearly nothing themselves.
+ */
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+
+static volatile sig_atomic_t churnRequests = 0;
+static volatile sig_atomic_t quit = 0;
+
+static void onChurn(int) { ++churnRequests; }
+static void onQuit(int) { quit = 1; }
+
+static void setTitle(Display *dpy, Window w, Atom netName, Atom utf8,
+                     const char *title) {
+  XStoreName(dpy, w, title);
+  XChangeProperty(dpy, w, netName, utf8, 8, PropModeReplace,
+                  (const unsigned char *)title, strlen(title));
+}
+
+int main(int argc, char **argv) {
+  const int count = argc == 2 ? atoi(argv[1]) : 0;
+  if (count < 1) {
+    fprintf(stderr, "usage: q4win10_clients N\n");
+    return 2;
+  }
+
+  Display *dpy = XOpenDisplay(0);
+  if (!dpy) {
+    fprintf(stderr, "q4win10_clients: cannot open the display\n");
+    return 2;
+  }
+  const int screen = DefaultScreen(dpy);
+  const Atom netName = XInternAtom(dpy, "_NET_WM_NAME", False);
+  const Atom utf8 = XInternAtom(dpy, "UTF8_STRING", False);
+  const Atom netIcon = XInternAtom(dpy, "_NET_WM_ICON", False);
+  const Atom menuBar = XInternAtom(dpy, "_Q4WIN10_MENUBAR_HEIGHT", False);
+
+  // 16x16 ARGB icon, a blue square with a white frame
+  long icon[2 + 16 * 16];
+  icon[0] = icon[1] = 16;
+  for (int y = 0; y < 16; ++y)
+    for (int x = 0; x < 16; ++x)
+      icon[2 + y * 16 + x] = x == 0 || y == 0 || x == 15 || y == 15
+                                 ? 0xffffffffL
+                                 : 0xff0078d7L;
+  const long menuBarHeight = 22;
+
+  // cascaded over the screen, positions are kept by twin (USPosition)
+  const int columns = 16, rows = 12;
+  Window *windows = new Window[count];
+  char title[64];
+  for (int i = 0; i < count; ++i) {
+    const int x = (i % columns) * 230 + (i / (columns * rows)) * 8;
+    const int y = 40 + ((i / columns) % rows) * 170;
+    windows[i] = XCreateSimpleWindow(dpy, RootWindow(dpy, screen), x, y, 200,
+                                     120, 0, BlackPixel(dpy, screen),
+                                     WhitePixel(dpy, screen));
+    XSizeHints hints;
+    hints.flags = USPosition | USSize;
+    hints.x = x;
+    hints.y = y;
+    hints.width = 200;
+    hints.height = 120;
+    XSetWMNormalHints(dpy, windows[i], &hints);
+
+    snprintf(title, sizeof(title), "win %d", i);
+    setTitle(dpy, windows[i], netName, utf8, title);
+    XChangeProperty(dpy, windows[i], netIcon, XA_CARDINAL, 32, PropModeReplace,
+                    (const unsigned char *)icon, 2 + 16 * 16);
+    XChangeProperty(dpy, windows[i], menuBar, XA_CARDINAL, 32,
+                    PropModeReplace, (const unsigned char *)&menuBarHeight, 1);
+    XMapWindow(dpy, windows[i]);
+  }
+  XSync(dpy, False);
+  printf("ready\n");
+  fflush(stdout);
+
+  signal(SIGUSR1, onChurn);
+  signal(SIGTERM, onQuit);
+  signal(SIGINT, onQuit);
+
+  int round = 0;
+  while (!quit) {
+    while (XPending(dpy)) {
+      XEvent e;
+      XNextEvent(dpy, &e);
+    }
+    for (; churnRequests > 0; --churnRequests) {
+      ++round;
+      for (int i = 0; i < count; ++i) {
+        snprintf(title, sizeof(title), "win %d - update %d", i, round);
+        setTitle(dpy, windows[i], netName, utf8, title);
+      }
+      XSync(dpy, False);
+      printf("churned %d\n", round);
+      fflush(stdout);
+    }
+
+    // wake up for X events and every 50ms for the signals
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(ConnectionNumber(dpy), &fds);
+    struct timeval tv = {0, 50000};
+    select(ConnectionNumber(dpy) + 1, &fds, 0, 0, &tv);
+  }
+
+  delete[] windows;
+  XCloseDisplay(dpy);
+  return 0;
+}
@@ -0,0 +1,107 @@
+#!/bin/bash
+
+# Checks the USDT tracepoints of an SDT build (see README, Tracepoints):
+# every probe of the README table must be in the plugin's stapsdt notes
+# (readelf -n) and must fire during a scenario run with 10 windows
+# (bpftrace).
+#
+#   tests/scenario/probes.sh [-o OUTDIR]
+#
+# Builds the plugin with make SDT=1 and loads it from OUTDIR through
+# TDEDIRS, the installed plugin is not touched. Needs what run.sh needs,
+# plus readelf and bpftrace; bpftrace has to run as root.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+REPO="$(cd "$SCRIPT_DIR/../.." && pwd)"
+OUT_DIR="probe-results"
+
+while getopts "o:" opt; do
+    case $opt in
+        o) OUT_DIR="$OPTARG" ;;
+        *) echo "usage: $0 [-o OUTDIR]" >&2; exit 2 ;;
+    esac
+done
+
+for tool in readelf bpftrace; do
+    if ! command -v "$tool" >/dev/null 2>&1; then
+        echo "$0: $tool not found" >&2
+        exit 2
+    fi
+done
+
+mkdir -p "$OUT_DIR"
+OUT_DIR="$(cd "$OUT_DIR" && pwd)"
+
+# the probes the README lists, e.g. `paint_start` / `paint_done`
+EXPECTED=$(sed -n '/^## Tracepoints/,/^## /p' "$REPO/README.md" |
+    grep '^| `' | cut -d'|' -f2 | grep -o '`[a-z_]*`' | tr -d '`' | sort -u)
+# and the ones the code has
+USED=$(grep -oh 'Q4WIN10_PROBE[0-9](\?[a-z_]*' "$REPO"/q4win10*.cpp |
+    sed 's/.*(//' | sort -u)
+if [ "$EXPECTED" != "$USED" ]; then
+    echo "README and code list different probes:" >&2
+    diff <(echo "$EXPECTED") <(echo "$USED") >&2 || true
+    exit 1
+fi
+
+# a fresh SDT build, loaded instead of the installed one
+make -s -C "$REPO" -B SDT=1 twin3_q4win10.so
+PREFIX="$OUT_DIR/prefix"
+mkdir -p "$PREFIX/lib/trinity"
+cp "$REPO/twin3_q4win10.so" "$PREFIX/lib/trinity/"
+PLUGIN="$PREFIX/lib/trinity/twin3_q4win10.so"
+export TDEDIRS="$PREFIX:${TDEDIRS:-/opt/trinity}"
+
+failed=0
+
+# every probe must have a note
+NOTES=$(readelf -n "$PLUGIN" |
+    awk '/Provider:/ { provider = $2 }
+         /Name:/ && provider == "q4win10" { print $2 }' | sort -u)
+for p in $EXPECTED; do
+    if ! echo "$NOTES" | grep -qx "$p"; then
+        echo "q4win10:$p: no stapsdt note in $PLUGIN"
+        failed=1
+    fi
+done
+
+# and must fire; uprobes attach to the file, so a twin started later is
+# traced as well
+BPF_OUT="$OUT_DIR/bpftrace.txt"
+bpftrace -e "usdt:$PLUGIN:q4win10:* { @[probe] = count(); }" \
+    > "$BPF_OUT" 2>&1 &
+BPF_PID=$!
+for i in $(seq 100); do
+    grep -q Attaching "$BPF_OUT" && break
+    sleep 0.1
+done
+if ! grep -q Attaching "$BPF_OUT"; then
+    echo "bpftrace did not attach, see $BPF_OUT" >&2
+    kill "$BPF_PID" 2>/dev/null || true
+    exit 1
+fi
+
+# an SDT build, not a profile build: no request counts
+"$SCRIPT_DIR/run.sh" -n -o "$OUT_DIR/scenario" 10 || failed=1
+
+kill -INT "$BPF_PID"
+wait "$BPF_PID" 2>/dev/null || true
+
+for p in $EXPECTED; do
+    # @[usdt:/path/twin3_q4win10.so:q4win10:paint_start]: 1234
+    n=$(sed -n "s/^@\[usdt:.*:q4win10:$p\]: \([0-9]*\)$/\1/p" "$BPF_OUT")
+    if [ -z "$n" ] || [ "$n" -eq 0 ]; then
+        echo "q4win10:$p: did not fire"
+        failed=1
+    else
+        echo "q4win10:$p: $n"
+    fi
+done
+
+if [ "$failed" != 0 ]; then
+    echo "probe check failed, bpftrace output in $BPF_OUT" >&2
+    exit 1
+fi
+echo "all $(echo "$EXPECTED" | wc -l) probes present and firing"
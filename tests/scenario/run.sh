@@ -0,0 +1,386 @@
+#!/bin/bash
+
+# End-to-end scenario run: real twin with twin3_q4win10 on Xvfb, driven by
+# XTest input, at 10, 100 and 1000 windows (see README, Scaling Scenarios).
+#
+#   tests/scenario/run.sh [-o OUTDIR] [-d DISPLAY] [-l MS] [-m] [-n] [COUNT...]
+#
+# -l puts q4win10_xdelay between the X server and everything else, which
+# holds each chunk back by MS milliseconds in either direction (a round
+# trip costs 2 * MS, like a remote display).
+#
+# -m adds the two-screen runs, see run_screens().
+#
+# Needs Xvfb, dbus-launch, xdotool, xprop, twin and the plugin installed.
+# The plugin has to be a Q4WIN10_PROFILE build, the X request counts come
+# from its profile; q4win10_roundtrips.so next to it is preloaded into twin
+# to count the round trips. -n runs a plain build anyway; the summary then says
+# that the counts are missing and has CPU and paint times only.
+#
+# The paint times are the durations of the paint slices of the trace, the
+# time spent in the paint handler. They do not include the wait between
+# the X event and the paint.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+OUT_DIR="scenario-results"
+DISPLAY_NAME=":9"
+LATENCY=0
+SCREENS=0
+NO_COUNTS=0
+
+while getopts "o:d:l:mn" opt; do
+    case $opt in
+        o) OUT_DIR="$OPTARG" ;;
+        d) DISPLAY_NAME="$OPTARG" ;;
+        l) LATENCY="$OPTARG" ;;
+        m) SCREENS=1 ;;
+        n) NO_COUNTS=1 ;;
+        *) echo "usage: $0 [-o OUTDIR] [-d DISPLAY] [-l MS] [-m] [-n] [COUNT...]" >&2; exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+COUNTS="${*:-10 100 1000}"
+
+for tool in Xvfb dbus-launch xdotool xprop twin tde-config g++; do
+    if ! command -v "$tool" >/dev/null 2>&1; then
+        echo "$0: $tool not found" >&2
+        exit 2
+    fi
+done
+
+# the plugin twin will load, TDEDIRS (see probes.sh) may point elsewhere;
+# a profile build reads Q4WIN10_PROFILE_OUTPUT
+PLUGIN=
+for dir in $(tde-config --path module 2>/dev/null | tr : ' '); do
+    if [ -f "$dir/twin3_q4win10.so" ]; then
+        PLUGIN="$dir/twin3_q4win10.so"
+        break
+    fi
+done
+if [ -z "$PLUGIN" ]; then
+    echo "$0: twin3_q4win10.so not found in the module path" >&2
+    exit 2
+fi
+PROFILE_BUILD=0
+grep -q Q4WIN10_PROFILE_OUTPUT "$PLUGIN" && PROFILE_BUILD=1
+if [ "$PROFILE_BUILD" = 0 ] && [ "$NO_COUNTS" = 0 ]; then
+    echo "$0: $PLUGIN is not a Q4WIN10_PROFILE build, there would be no X" >&2
+    echo "request counts; install a make PROFILE=1 build or pass -n" >&2
+    exit 2
+fi
+ROUNDTRIPS=
+if [ "$PROFILE_BUILD" = 1 ]; then
+    ROUNDTRIPS="$(dirname "$PLUGIN")/q4win10_roundtrips.so"
+    if [ ! -f "$ROUNDTRIPS" ]; then
+        echo "$0: $ROUNDTRIPS not found, the round trips would not be" >&2
+        echo "counted; make PROFILE=1 install puts it there" >&2
+        exit 2
+    fi
+fi
+
+mkdir -p "$OUT_DIR"
+OUT_DIR="$(cd "$OUT_DIR" && pwd)"
+SUMMARY="$OUT_DIR/summary.txt"
+: > "$SUMMARY"
+if [ "$PROFILE_BUILD" = 0 ]; then
+    echo "NO X REQUEST COUNTS: $PLUGIN is not a Q4WIN10_PROFILE build" |
+        tee -a "$SUMMARY"
+fi
+
+# the window program
+CLIENTS="$OUT_DIR/q4win10_clients"
+g++ -O2 -o "$CLIENTS" "$SCRIPT_DIR/clients.cpp" -lX11
+# the delaying proxy listens on the next display number
+XDELAY="$OUT_DIR/q4win10_xdelay"
+PROXY_DISPLAY=":$((${DISPLAY_NAME#:} + 1))"
+if [ "$LATENCY" -gt 0 ]; then
+    g++ -O2 -o "$XDELAY" "$SCRIPT_DIR/xdelay.cpp"
+fi
+
+# twin settings of our own: the plugin, four desktops, no effects
+export TDEHOME="$OUT_DIR/tdehome"
+mkdir -p "$TDEHOME/share/config"
+cat > "$TDEHOME/share/config/twinrc" <<EOF
+[Style]
+PluginLib=twin3_q4win10
+
+[Desktops]
+Number=4
+
+[Windows]
+AnimateMinimize=false
+FocusPolicy=ClickToFocus
+EOF
+
+CLK_TCK=$(getconf CLK_TCK)
+
+report() {
+    echo "$*" | tee -a "$SUMMARY"
+}
+
+# utime + stime of twin in milliseconds
+twin_cpu() {
+    awk -v tck="$CLK_TCK" '{ print int(($14 + $15) * 1000 / tck) }' \
+        "/proc/$TWIN_PID/stat"
+}
+
+# waits until the trace has been written out (once a second), then
+# remembers where the phase starts
+mark() {
+    sleep 1.5
+    MARK_LINE=$(cat "$TRACE" 2>/dev/null | wc -l)
+    MARK_CPU=$(twin_cpu)
+    MARK_TIME=$(date +%s%N)
+}
+
+# paint slices of the trace since mark(): count, median, 95th percentile
+# and maximum duration in microseconds
+paint_time() {
+    tail -n +"$((MARK_LINE + 1))" "$TRACE" |
+        grep '"name": "paint"' |
+        sed 's/.*"dur": \([0-9]*\).*/\1/' |
+        sort -n |
+        awk '{ d[NR] = $1 }
+             END {
+               if (NR == 0) { print "0 paints"; exit }
+               printf "%d paints, paint time median %d us, p95 %d us, max %d us\n",
+                      NR, d[int((NR + 1) / 2)], d[int((NR * 95 + 99) / 100)],
+                      d[NR]
+             }'
+}
+
+# twin CPU time includes the work still queued when the input ended
+phase_end() {
+    local name="$1"
+    local wall=$((($(date +%s%N) - MARK_TIME) / 1000000))
+    sleep 1.5
+    local cpu=$(($(twin_cpu) - MARK_CPU))
+    report "  $(printf '%-10s' "$name") twin CPU ${cpu} ms in ${wall} ms, $(paint_time)"
+}
+
+# a point inside the client area of window i of q4win10_clients
+client_point() {
+    local i=$1
+    echo "$(((i % 16) * 230 + 100)) $((40 + ((i / 16) % 12) * 170 + 60))"
+}
+
+run() {
+    local n=$1
+    TRACE="$OUT_DIR/trace-$n.json"
+    local profile="$OUT_DIR/profile-$n.json"
+    rm -f "$TRACE" "$profile"
+
+    export DISPLAY="$DISPLAY_NAME"
+    Xvfb "$DISPLAY" -screen 0 3840x2160x24 -nolisten tcp 2>/dev/null &
+    local xvfb_pid=$!
+    for i in $(seq 50); do
+        xprop -root >/dev/null 2>&1 && break
+        sleep 0.1
+    done
+
+    local proxy_pid=
+    if [ "$LATENCY" -gt 0 ]; then
+        "$XDELAY" "${DISPLAY_NAME#:}" "${PROXY_DISPLAY#:}" "$LATENCY" &
+        proxy_pid=$!
+        export DISPLAY="$PROXY_DISPLAY"
+        for i in $(seq 50); do
+            xprop -root >/dev/null 2>&1 && break
+            sleep 0.1
+        done
+    fi
+
+    eval "$(dbus-launch --sh-syntax)"
+    LD_PRELOAD="$ROUNDTRIPS" Q4WIN10_TRACE="$TRACE" \
+        Q4WIN10_PROFILE_OUTPUT="$profile" twin >"$OUT_DIR/twin-$n.log" 2>&1 &
+    TWIN_PID=$!
+    for i in $(seq 100); do
+        xprop -root _NET_SUPPORTING_WM_CHECK 2>/dev/null | grep -q window && break
+        sleep 0.1
+    done
+
+    if [ "$LATENCY" -gt 0 ]; then
+        report "$n windows, ${LATENCY} ms added latency"
+    else
+        report "$n windows"
+    fi
+
+    # adoption: the paints include the replies the first paint waits for
+    mark
+    "$CLIENTS" "$n" > "$OUT_DIR/clients-$n.log" &
+    local clients_pid=$!
+    for i in $(seq 600); do
+        grep -q ready "$OUT_DIR/clients-$n.log" && break
+        sleep 0.1
+    done
+    # let twin manage and decorate all of them
+    sleep 3
+    phase_end adopt
+
+    # focus cycling through the window list
+    mark
+    for i in $(seq 50); do
+        xdotool key --delay 20 alt+Tab
+    done
+    phase_end focus
+
+    # alt + left drag moves, alt + right drag resizes
+    mark
+    for i in $(seq 0 $(((n < 20 ? n : 20) - 1))); do
+        set -- $(client_point "$i")
+        xdotool mousemove "$1" "$2" keydown alt mousedown 1 \
+            mousemove $(($1 + 40)) $(($2 + 30)) mouseup 1 keyup alt
+    done
+    phase_end move
+    mark
+    for i in $(seq 0 $(((n < 20 ? n : 20) - 1))); do
+        set -- $(client_point "$i")
+        xdotool mousemove "$(($1 + 40))" "$(($2 + 30))" keydown alt \
+            mousedown 3 mousemove $(($1 + 120)) $(($2 + 90)) mouseup 3 keyup alt
+    done
+    phase_end resize
+
+    # desktop switching, all windows live on the first desktop
+    mark
+    for i in $(seq 4); do
+        xdotool key ctrl+F2
+        sleep 0.2
+        xdotool key ctrl+F1
+        sleep 0.2
+    done
+    phase_end desktop
+
+    # title churn: every window retitled 10 times
+    mark
+    for i in $(seq 10); do
+        kill -USR1 "$clients_pid"
+        sleep 0.2
+    done
+    phase_end title
+
+    kill "$clients_pid" 2>/dev/null || true
+    wait "$clients_pid" 2>/dev/null || true
+    # twin unloads the plugin on SIGTERM, which writes the profile
+    kill "$TWIN_PID" 2>/dev/null || true
+    wait "$TWIN_PID" 2>/dev/null || true
+    kill "$DBUS_SESSION_BUS_PID" 2>/dev/null || true
+    if [ -n "$proxy_pid" ]; then
+        kill "$proxy_pid" 2>/dev/null || true
+        wait "$proxy_pid" 2>/dev/null || true
+    fi
+    kill "$xvfb_pid" 2>/dev/null || true
+    wait "$xvfb_pid" 2>/dev/null || true
+
+    if [ -s "$profile" ]; then
+        report "  X requests of the decoration per operation (calls, requests, round trips, worst call):"
+        grep '"requests": [0-9]' "$profile" |
+            sed 's/.*"name": "\([a-zA-Z]*\)", "calls": \([0-9]*\), "requests": \([0-9]*\), "round_trips": \([0-9]*\), "max_requests": \([0-9]*\).*/\1 \2 \3 \4 \5/' |
+            while read -r op calls requests trips worst; do
+                report "    $(printf '%-14s %6d %8d %6d %5d' "$op" "$calls" "$requests" "$trips" "$worst")"
+            done
+    elif [ "$PROFILE_BUILD" = 1 ]; then
+        report "  NO X REQUEST COUNTS: twin wrote no profile, see twin-$n.log"
+    else
+        report "  NO X REQUEST COUNTS: not a Q4WIN10_PROFILE build"
+    fi
+}
+
+# Two screens. X windows cannot change X screens, and twin runs one
+# process per screen, so the depth 16 screen is checked with the harness:
+# q4win10_screentest puts decorations on both screens of
+#   Xvfb -screen 0 1920x1080x24 -screen 1 1920x1080x16
+# Moving a window is checked with real twin on a 4K and a 1080p Xinerama
+# screen: the frame must shrink to the scale of the 1080p screen and the
+# caption must be rendered again.
+run_screens() {
+    local failed=0
+    export DISPLAY="$DISPLAY_NAME"
+
+    report "two screens, depth 24 and 16"
+    make -s -C "$SCRIPT_DIR/../.." tests/q4win10_screentest
+    Xvfb "$DISPLAY" -screen 0 1920x1080x24 -screen 1 1920x1080x16 \
+        -nolisten tcp 2>/dev/null &
+    local xvfb_pid=$!
+    for i in $(seq 50); do
+        xprop -root >/dev/null 2>&1 && break
+        sleep 0.1
+    done
+    if "$SCRIPT_DIR/../q4win10_screentest" > "$OUT_DIR/screentest.log" 2>&1; then
+        report "  tile sets and captions per screen: ok"
+    else
+        report "  tile sets and captions per screen: FAILED, see screentest.log"
+        failed=1
+    fi
+    kill "$xvfb_pid" 2>/dev/null || true
+    wait "$xvfb_pid" 2>/dev/null || true
+
+    report "window moved from a 4K to a 1080p Xinerama screen"
+    TRACE="$OUT_DIR/trace-screens.json"
+    rm -f "$TRACE"
+    Xvfb "$DISPLAY" +xinerama -screen 0 3840x2160x24 -screen 1 1920x1080x24 \
+        -nolisten tcp 2>/dev/null &
+    xvfb_pid=$!
+    for i in $(seq 50); do
+        xprop -root >/dev/null 2>&1 && break
+        sleep 0.1
+    done
+    eval "$(dbus-launch --sh-syntax)"
+    Q4WIN10_TRACE="$TRACE" twin > "$OUT_DIR/twin-screens.log" 2>&1 &
+    TWIN_PID=$!
+    for i in $(seq 100); do
+        xprop -root _NET_SUPPORTING_WM_CHECK 2>/dev/null | grep -q window && break
+        sleep 0.1
+    done
+    "$CLIENTS" 1 > "$OUT_DIR/clients-screens.log" &
+    local clients_pid=$!
+    for i in $(seq 100); do
+        grep -q ready "$OUT_DIR/clients-screens.log" && break
+        sleep 0.1
+    done
+    sleep 2
+
+    local w
+    w=$(xdotool search --name '^win 0$' | head -n 1)
+    # top of _NET_FRAME_EXTENTS: left, right, top, bottom
+    local before after
+    before=$(xprop -id "$w" _NET_FRAME_EXTENTS | sed 's/.*= *//' | cut -d, -f3 | tr -d ' ')
+    mark
+    # on screen 1, the resize makes the decoration look at its screen again
+    xdotool windowmove "$w" 4000 200 windowsize "$w" 300 200
+    sleep 1
+    after=$(xprop -id "$w" _NET_FRAME_EXTENTS | sed 's/.*= *//' | cut -d, -f3 | tr -d ' ')
+    sleep 1.5
+    local renders
+    renders=$(tail -n +"$((MARK_LINE + 1))" "$TRACE" |
+        grep '"name": "renderCaption"' |
+        grep -c "\"window\": \"$(printf '0x%x' "$w")\"" || true)
+    if [ -n "$before" ] && [ -n "$after" ] && [ "$after" -lt "$before" ] &&
+       [ "$renders" -gt 0 ]; then
+        report "  frame top ${before} -> ${after} px, caption rendered ${renders}x: ok"
+    else
+        report "  frame top ${before:-?} -> ${after:-?} px, caption rendered ${renders:-0}x: FAILED"
+        failed=1
+    fi
+
+    kill "$clients_pid" 2>/dev/null || true
+    wait "$clients_pid" 2>/dev/null || true
+    kill "$TWIN_PID" 2>/dev/null || true
+    wait "$TWIN_PID" 2>/dev/null || true
+    kill "$DBUS_SESSION_BUS_PID" 2>/dev/null || true
+    kill "$xvfb_pid" 2>/dev/null || true
+    wait "$xvfb_pid" 2>/dev/null || true
+    return $failed
+}
+
+for n in $COUNTS; do
+    run "$n"
+done
+
+SCREENS_FAILED=0
+if [ "$SCREENS" = 1 ]; then
+    run_screens || SCREENS_FAILED=1
+fi
+
+echo "Results in $OUT_DIR (summary.txt, trace-N.json, profile-N.json)"
+exit $SCREENS_FAILED
@@ -0,0 +1,213 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Delaying X proxy for the scenario run, see run.sh -l.
+ *
+ *   q4win10_xdelay LISTEN TARGET MS
+ *
+ * Accepts X connections on display :LISTEN and forwards each to display
+ * :TARGET, both over the local socket, holding every chunk back by MS
+ * milliseconds in either direction. A round trip then costs 2 * MS, like a
+ * remote display, while requests that need no reply still stream. SIGTERM
+ * ends the program.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+// bytes read from one side, due for the other side at a given time
+struct Chunk {
+  long long due; // usec
+  std::string data;
+};
+
+struct Link {
+  int fd[2];                 // client, server
+  bool eof[2];               // fd[i] has nothing more to read
+  std::deque<Chunk> out[2];  // pending for fd[0], fd[1]
+};
+
+static volatile sig_atomic_t quit = 0;
+
+static void onQuit(int) { quit = 1; }
+
+static long long now() {
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void socketPath(int display, struct sockaddr_un *addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  snprintf(addr->sun_path, sizeof(addr->sun_path), "/tmp/.X11-unix/X%d",
+           display);
+}
+
+static bool writeAll(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    const ssize_t n = write(fd, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 4) {
+    fprintf(stderr, "usage: q4win10_xdelay LISTEN TARGET MS\n");
+    return 2;
+  }
+  const int listenDisplay = atoi(argv[1]);
+  const int targetDisplay = atoi(argv[2]);
+  const long long delay = atoll(argv[3]) * 1000;
+
+  struct sockaddr_un listenAddr, targetAddr;
+  socketPath(listenDisplay, &listenAddr);
+  socketPath(targetDisplay, &targetAddr);
+
+  const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(listenAddr.sun_path);
+  if (listener < 0 ||
+      bind(listener, (struct sockaddr *)&listenAddr, sizeof(listenAddr)) < 0 ||
+      listen(listener, 64) < 0) {
+    perror("q4win10_xdelay");
+    return 2;
+  }
+
+  signal(SIGTERM, onQuit);
+  signal(SIGINT, onQuit);
+  signal(SIGPIPE, SIG_IGN);
+
+  std::vector<Link> links;
+  std::vector<struct pollfd> fds;
+  std::vector<int> polled; // link * 2 + side of fds[1...]
+  static char buf[65536];
+
+  while (!quit) {
+    // sleep until the next chunk is due or a socket has data
+    const long long t = now();
+    long long next = -1;
+    fds.clear();
+    polled.clear();
+    struct pollfd l = {listener, POLLIN, 0};
+    fds.push_back(l);
+    for (size_t i = 0; i < links.size(); ++i)
+      for (int side = 0; side < 2; ++side) {
+        if (!links[i].eof[side]) {
+          struct pollfd p = {links[i].fd[side], POLLIN, 0};
+          fds.push_back(p);
+          polled.push_back(i * 2 + side);
+        }
+        if (!links[i].out[side].empty()) {
+          const long long due = links[i].out[side].front().due;
+          if (next < 0 || due < next)
+            next = due;
+        }
+      }
+    const int timeout = next < 0 ? 1000 : next <= t ? 0 : (next - t) / 1000 + 1;
+    if (poll(&fds[0], fds.size(), timeout) < 0 && errno != EINTR)
+      break;
+
+    if (fds[0].revents & POLLIN) {
+      const int client = accept(listener, 0, 0);
+      const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (client >= 0 && server >= 0 &&
+          connect(server, (struct sockaddr *)&targetAddr,
+                  sizeof(targetAddr)) == 0) {
+        Link link;
+        link.fd[0] = client;
+        link.fd[1] = server;
+        link.eof[0] = link.eof[1] = false;
+        links.push_back(link);
+      } else {
+        if (client >= 0)
+          close(client);
+        if (server >= 0)
+          close(server);
+      }
+    }
+
+    // read what arrived, queue it for the other side
+    const long long arrived = now();
+    for (size_t f = 1; f < fds.size(); ++f) {
+      if (!(fds[f].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      Link &link = links[polled[f - 1] / 2];
+      const int side = polled[f - 1] % 2;
+      const ssize_t n = read(link.fd[side], buf, sizeof(buf));
+      if (n < 0 && errno == EINTR)
+        continue;
+      // an empty chunk closes the link once the data before it is out
+      Chunk c = {arrived + delay, std::string(buf, n > 0 ? n : 0)};
+      link.out[1 - side].push_back(c);
+      if (n <= 0)
+        link.eof[side] = true;
+    }
+
+    // send what is due, close finished links
+    const long long sendTime = now();
+    for (size_t i = 0; i < links.size();) {
+      bool closed = false;
+      for (int side = 0; side < 2 && !closed; ++side) {
+        std::deque<Chunk> &out = links[i].out[side];
+        while (!out.empty() && out.front().due <= sendTime) {
+          if (out.front().data.empty() ||
+              !writeAll(links[i].fd[side], out.front().data.data(),
+                        out.front().data.size())) {
+            closed = true;
+            break;
+          }
+          out.pop_front();
+        }
+      }
+      if (closed) {
+        close(links[i].fd[0]);
+        close(links[i].fd[1]);
+        links.erase(links.begin() + i);
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < links.size(); ++i) {
+    close(links[i].fd[0]);
+    close(links[i].fd[1]);
+  }
+  close(listener);
+  unlink(listenAddr.sun_path);
+  return 0;
+}
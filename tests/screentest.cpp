@@ -0,0 +1,120 @@
+/* Q4Win10 KWin window decoration
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; see the file COPYING.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Tile sets per X screen: on a display with two screens of different
+ * depths, e.g.
+ *
+ *   Xvfb :9 -screen 0 1920x1080x24 -screen 1 1920x1080x16
+ *
+ * a decoration on the second screen must use a tile set of its own, with
+ * tiles and captions on that screen and in its depth, while the one on the
+ * first screen keeps its set. A window that reappears on the second screen
+ * (twin runs one process per screen, X windows cannot change screens) gets
+ * the cached set back. Run by tests/scenario/run.sh -m; exits 77 on a
+ * display with one screen.
+ */
+
+#include <tqpixmap.h>
+
+#include <X11/Xlib.h>
+#include <stdio.h>
+
+#include "../q4win10client.h"
+#include "harness.h"
+
+using namespace KWinQ4Win10;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: %s failed\n", __FILE__, __LINE__, #cond);        \
+      ++failures;                                                              \
+    }                                                                          \
+  } while (0)
+
+// the tiles and captions of client are on screen, in its default depth
+static void checkScreen(Harness &harness, Q4Win10Client *client, int screen) {
+  const int depth = DefaultDepth(harness.display(), screen);
+  const TileVariant &v = client->tileVariant();
+  CHECK(client->widget()->x11Screen() == screen);
+  CHECK(v.x11Screen == screen);
+
+  const TQPixmap &tile = Handler()->pixmap(TitleBarTileTop, true, false, v);
+  CHECK(tile.x11Screen() == screen);
+  CHECK(tile.depth() == depth);
+
+  for (int active = 0; active < 2; ++active) {
+    const TQPixmap &caption = HarnessAccess::captionPixmap(client, active);
+    CHECK(caption.x11Screen() == screen);
+    CHECK(caption.depth() == depth);
+  }
+}
+
+int main() {
+  Harness harness("q4win10_screentest");
+  if (ScreenCount(harness.display()) < 2) {
+    fprintf(stderr, "q4win10_screentest: the display has one screen\n");
+    return 77;
+  }
+  printf("screen 0 depth %d, screen 1 depth %d\n",
+         DefaultDepth(harness.display(), 0),
+         DefaultDepth(harness.display(), 1));
+
+  MockBridge first;
+  Q4Win10Client *a = harness.createClient(&first);
+  harness.repaint(a);
+  checkScreen(harness, a, 0);
+
+  MockBridge second;
+  second.state.x11Screen = 1;
+  Q4Win10Client *b = harness.createClient(&second);
+  harness.repaint(b);
+  checkScreen(harness, b, 1);
+
+  // one set per screen, both kept
+  const TQPixmap *tile0 =
+      &Handler()->pixmap(TitleBarTileTop, true, false, a->tileVariant());
+  const TQPixmap *tile1 =
+      &Handler()->pixmap(TitleBarTileTop, true, false, b->tileVariant());
+  CHECK(tile0 != tile1);
+  CHECK(a->tileVariant().key() != b->tileVariant().key());
+
+  // the window of the first screen reappears on the second
+  harness.destroyClient(a);
+  MockBridge moved;
+  moved.state.x11Screen = 1;
+  moved.state.caption = first.state.caption;
+  Q4Win10Client *c = harness.createClient(&moved);
+  harness.repaint(c);
+  checkScreen(harness, c, 1);
+  CHECK(&Handler()->pixmap(TitleBarTileTop, true, false, c->tileVariant()) ==
+        tile1);
+
+  harness.destroyClient(b);
+  harness.destroyClient(c);
+
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  printf("tile sets per screen OK\n");
+  return 0;
+}